@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BLAKE2S_H
+#define BLAKE2S_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLAKE2S_BLOCK_SIZE	64
+#define BLAKE2S_HASH_SIZE	32
+
+/* BLAKE2s-256 without a key (RFC 7693) */
+struct blake2s_state {
+	u32 h[8];
+	u32 t[2];
+	u8 buf[BLAKE2S_BLOCK_SIZE];
+	size_t buflen;
+};
+
+void blake2s_init(struct blake2s_state *s);
+void blake2s_update(struct blake2s_state *s, const void *data, size_t len);
+void blake2s_final(struct blake2s_state *s, u8 *digest);
+/* "SSE2" or "generic", whichever blake2s_init() picked */
+const char *blake2s_impl(void);
+
+#endif
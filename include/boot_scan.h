@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BOOT_SCAN_H
+#define BOOT_SCAN_H
+
+enum boot_path_state {
+	BOOT_PATH_UNKNOWN,
+	BOOT_PATH_PRESENT,
+	BOOT_PATH_ABSENT,
+};
+
+/*
+ * Check the hardware behind a SeaBIOS boot path from bootorder_def, e.g.
+ * /pci@i0cf8/usb@10/usb-*@1: the PCI functions along the path and the
+ * SATA, SD or USB port it ends in. Paths that are not PCI, or controllers
+ * in a mode the scan does not know, are reported as unknown.
+ */
+enum boot_path_state scan_boot_path(const char *path);
+
+#endif
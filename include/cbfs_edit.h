@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef CBFS_EDIT_H
+#define CBFS_EDIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Find an uncompressed CBFS file in flash. address is its data in the
+ * memory mapped ROM, as used for the bootorder.
+ */
+int cbfs_locate_raw(const char *name, u32 *address, size_t *size);
+
+/*
+ * Replace the contents of a CBFS file in place. The file keeps its size,
+ * so len has to match it.
+ */
+int cbfs_rewrite_file(const char *name, const void *data, size_t len);
+
+#endif
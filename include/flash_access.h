@@ -27,8 +27,18 @@
 
 int init_flash(void);
 int is_flash_locked(void);
+/*
+ * Leave [address, address + len) writable when locking, if the chip's block
+ * protection can express it, so saving there needs no status register write.
+ */
+void flash_keep_writable(u32 address, u32 len);
 int lock_flash(void);
 int unlock_flash(void);
+/*
+ * Read by flash offset through the driver, which refreshes the ROM window
+ * after writes and falls back to SPI reads where the window can't be used.
+ */
+int read_flash(u32 offset, void *buf, size_t len);
 int read_sec_status(void);
 int read_sec(u8 reg, u8 addr, void *buf, size_t len);
 int erase_sec(u8 reg, u8 addr, size_t len);
@@ -37,6 +47,46 @@ int lock_sec(u8 reg);
 int send_flash_cmd(u8 cmd, void *response, size_t len);
 int send_flash_cmd_write(u8 command, size_t cmd_len, const void *data,
 			 size_t data_len);
-void save_flash(u32 flash_address, char buffer[MAX_DEVICES][MAX_LENGTH], u8 max_lines, u8 spi_wp_toggle);
+/*
+ * Status registers 1 and 2 as cached by the flash driver. Writes go to the
+ * non-volatile bits and drop the cache, so the next read shows what the
+ * chip accepted. refresh_status_regs() makes the next read go to the chip.
+ * write_status_regs_volatile() only changes the bits until the next power
+ * cycle and fails on parts without a volatile status register.
+ */
+int read_status_regs(u8 *sr1, u8 *sr2);
+int write_status_regs(u8 sr1, u8 sr2);
+int write_status_regs_volatile(u8 sr1, u8 sr2);
+/*
+ * Block protection settings of the probed chip, one per distinct range, and
+ * the SR1/SR2 bits they use. Returns the number of settings, 0 if unknown.
+ */
+struct spi_flash_bp;
+int flash_bp_table(const struct spi_flash_bp **table, u8 mask[2]);
+const struct spi_flash_bp *flash_bp_lookup(u8 sr1, u8 sr2);
+void refresh_status_regs(void);
+/*
+ * Keep the SPI bus claimed for writing across several flash operations,
+ * so the IMC is only put to sleep and woken up once.
+ */
+int flash_session_begin(void);
+void flash_session_end(void);
+#ifdef BOOTORDER_AB
+/*
+ * The BOOTORDER region holds two slots ending in a generation trailer, the
+ * newer valid one is active. bootorder_ab_init() returns the offset of the
+ * active slot or a negative value if the region is too small for two.
+ * bootorder_ab_prepare() queues an erase of the other slot, so saving
+ * only has to program it.
+ */
+int bootorder_ab_init(u32 region, u32 size);
+void bootorder_ab_prepare(void);
+#endif
+/*
+ * Read-modify-write the sectors holding [address, address + len), then
+ * verify them. Write protection is lifted and restored as for a save.
+ */
+int flash_rewrite_range(u32 address, const void *data, size_t len);
+int save_flash(u32 flash_address, char buffer[MAX_DEVICES][MAX_LENGTH], u8 max_lines, u8 spi_wp_toggle);
 
 #endif
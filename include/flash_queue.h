@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Queue of flash jobs advanced by flash_queue_poll() one erase or page
+ * program at a time, so the caller never blocks on a busy chip.
+ */
+
+/* Job still runs after a cancel or an error, e.g. to restore protection */
+#define FLASH_JOB_ALWAYS	(1 << 0)
+
+#define FLASH_QUEUE_CANCELLED	1
+
+struct spi_flash;
+
+void flash_queue_init(struct spi_flash *flash);
+
+/* Data of a program job must stay valid until the job is done */
+int flash_queue_erase(u32 offset, size_t len);
+int flash_queue_program(u32 offset, size_t len, const void *buf);
+/* Run a blocking step, e.g. a status register write, between the others */
+int flash_queue_call(int (*fn)(void), u8 flags);
+
+/* Returns nonzero while there are jobs left */
+int flash_queue_poll(void);
+int flash_queue_busy(void);
+/*
+ * Drop the queued jobs once the operation in progress has finished. Ignored
+ * once an erase or program of the run was issued, the data it destroyed is
+ * only back after the rest of the run.
+ */
+void flash_queue_cancel(void);
+void flash_queue_progress(u32 *done, u32 *total);
+
+/*
+ * Poll until the queue is empty, printing progress; 'c' cancels. Returns
+ * 0 on success, FLASH_QUEUE_CANCELLED or a negative value on error.
+ */
+int flash_queue_run(void);
+/* Same without reading the keyboard, for updates that must not stop */
+int flash_queue_wait(void);
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/*
+ * Startup phase markers. Each mark records the TSC at the end of the phase
+ * it names, profile_print() lists the phases with their durations, relative
+ * to the coreboot timestamp base if coreboot left a timestamp table.
+ */
+void profile_mark(const char *name);
+void profile_print(void);
+
+#endif
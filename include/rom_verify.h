@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef ROM_VERIFY_H
+#define ROM_VERIFY_H
+
+#include <stdint.h>
+#include <blake2s.h>
+
+/*
+ * CBFS file with one "<FMAP area> <BLAKE2s digest in hex>" line per region,
+ * "*" stands for the whole flash. The manifest's own data is hashed as if
+ * erased, so it can cover the region it is stored in.
+ */
+#define ROM_MANIFEST_FILE	"rom_manifest"
+
+enum rom_region_result {
+	ROM_REGION_OK,
+	ROM_REGION_MISMATCH,
+	ROM_REGION_MISSING,	/* no such FMAP area */
+	ROM_REGION_INVALID,	/* manifest line not understood */
+	ROM_REGION_UNREADABLE,	/* flash read failed */
+};
+
+typedef void (*rom_verify_report)(const char *region, int result,
+				  const u8 *digest);
+
+/*
+ * Hash the regions listed in the manifest, read through the flash driver,
+ * and report each one. Returns the number of regions not matching, -1 if
+ * there is no manifest or it can't be read.
+ */
+int rom_verify(rom_verify_report report);
+void handle_rom_verify(void);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef SEC_STORE_H
+#define SEC_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Key-value store in security register 1. The page starts with the serial
+ * as a plain string, where older versions wrote it, followed by a header
+ * with a CRC32 and the entries as type, length, value.
+ */
+
+#define SEC_STORE_REG		1
+#define SEC_STORE_SERIAL_LEN	16
+#define SEC_STORE_VALUE_MAX	64
+
+enum sec_store_key {
+	SEC_KEY_SERIAL = 1,
+	SEC_KEY_ASSET,
+	SEC_KEY_DATE,
+	SEC_KEY_MAC1 = 0x10,	/* 6 bytes each, NIC 1 to 4 */
+	SEC_KEY_MAC2,
+	SEC_KEY_MAC3,
+	SEC_KEY_MAC4,
+};
+
+/*
+ * Read the page into RAM, once. A page without a valid store starts out
+ * empty, apart from a serial written by an older version.
+ */
+int sec_store_load(void);
+/* Length of the value copied to buf, -1 if the key is not set */
+int sec_store_get(u8 key, void *buf, size_t len);
+/* Change the copy in RAM only, a zero length removes the key */
+int sec_store_set(u8 key, const void *data, size_t len);
+/* Iterate the keys set, returns the next key after key, 0 at the end */
+u8 sec_store_next(u8 key);
+/* Write all changes with one erase of the register, then verify them */
+int sec_store_commit(void);
+
+#endif
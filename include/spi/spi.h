@@ -56,6 +56,10 @@ struct spi_slave {
 	unsigned int	bus;
 	unsigned int	cs;
 	unsigned int	rw;
+	unsigned int	max_hz;		/* 0 keeps the firmware setting */
+	unsigned int	mode;
+	unsigned int	claim_depth;	/* nested spi_claim_bus() calls */
+	unsigned int	write_depth;	/* depth of the first write claim */
 };
 
 void spi_init(void);
@@ -86,7 +90,8 @@ struct spi_slave *spi_setup_slave(unsigned int bus, unsigned int cs,
  * will enable and initialize any SPI hardware as necessary, and make
  * sure that the SCK line is in the correct idle state. It is not
  * allowed to claim the same bus for several slaves without releasing
- * the bus in between.
+ * the bus in between. Claims nest, only the outermost one and the
+ * outermost one with SPI_WRITE_FLAG set in slave->rw touch the hardware.
  *
  *   slave:	The SPI slave
  *
@@ -131,6 +136,19 @@ void spi_release_bus(struct spi_slave *slave);
 int  spi_xfer(struct spi_slave *slave, const void *dout, unsigned int bitsout,
 		void *din, unsigned int bitsin);
 
+/*-----------------------------------------------------------------------
+ * Crop a transfer to what the controller can move in one spi_xfer().
+ *
+ *   slave:	The SPI slave
+ *   cmd_len:	Number of command bytes, including the opcode
+ *   buf_len:	Number of data bytes the caller would like to transfer
+ *
+ * Returns: The number of data bytes (at most buf_len) that fit in the
+ * controller FIFO together with the command.
+ */
+unsigned int spi_crop_chunk(const struct spi_slave *slave, unsigned int cmd_len,
+		unsigned int buf_len);
+
 /*-----------------------------------------------------------------------
  * Determine if a SPI chipselect is valid.
  * This function is provided by the board if the low-level SPI driver
@@ -161,12 +179,20 @@ void spi_cs_deactivate(struct spi_slave *slave);
 
 /*-----------------------------------------------------------------------
  * Set transfer speed.
- * This sets a new speed to be applied for next spi_xfer().
+ * This sets a new speed to be applied for next spi_xfer(). The closest
+ * speed the controller supports that is not above hz is used, 0 keeps
+ * the speed firmware left in the controller.
  *   slave:	The SPI slave
  *   hz:	The transfer speed
  */
 void spi_set_speed(struct spi_slave *slave, uint32_t hz);
 
+/*-----------------------------------------------------------------------
+ * Drop flash contents held by the ROM prefetch buffer and the CPU caches,
+ * so memory mapped reads see the result of program and erase commands.
+ */
+void spi_mmap_invalidate(void);
+
 /*-----------------------------------------------------------------------
  * Write 8 bits, then read 8 bits.
  *   slave:	The SPI slave we're communicating with
@@ -189,16 +215,24 @@ static inline int spi_w8r8(struct spi_slave *slave, unsigned char byte)
 	return ret < 0 ? ret : din[1];
 }
 
-static inline void spi_debug(const char *fmt, ...)
-{
-
+/*
+ * Debug output of the SPI drivers. Without SPI_DEBUG the call compiles to
+ * nothing, its arguments are type checked but never evaluated, so they may
+ * safely contain SPI transactions.
+ */
 #ifdef SPI_DEBUG
-	va_list ap;
-	va_start(ap, fmt);
-	vprintf(fmt, ap);
-	va_end(ap);
+#define spi_debug(fmt, ...)	printf(fmt, ##__VA_ARGS__)
+#else
+#define spi_debug(fmt, ...)	\
+	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
 #endif
 
-}
+#ifdef SPI_TRACE_RING
+/*-----------------------------------------------------------------------
+ * Print the last transfers recorded by spi_xfer(): opcode, address,
+ * write and read counts and time since the previous transfer.
+ */
+void spi_trace_dump(void);
+#endif
 
 #endif	/* _SPI_H_ */
@@ -47,11 +47,48 @@
 #define CONTROLLER_PAGE_LIMIT	((int)(~0U>>1))
 #endif
 
+/* One distinct block protection setting and the range it protects */
+struct spi_flash_bp {
+	u8		sr1;
+	u8		sr2;
+	u32		start;
+	u32		len;
+};
+
 struct spi_flash {
 	struct spi_slave *spi;
 	const char	*name;
 	u32		size;
 	u32		sector_size;
+	/* Program buffer size and opcode used by the common page program */
+	u32		page_size;
+	u8		program_cmd;
+	/* Opcode erasing one sector_size unit */
+	u8		erase_cmd;
+	/* Typical and maximum operation times in us, 0 when unknown */
+	u32		prog_typ_us;
+	u32		prog_max_us;
+	u32		erase_typ_us;
+	u32		erase_max_us;
+	/* Memory mapped view may be stale after program or erase */
+	u8		mmap_stale;
+	/* Status registers 1-3 as last read, bit n of sr_valid covers sr[n] */
+	u8		sr[3];
+	u8		sr_valid;
+	/* Range lock() leaves writable if the chip can, none when len is 0 */
+	u32		wp_keep_offset;
+	u32		wp_keep_len;
+	/* Block protect bits in SR1/SR2 and the range a setting protects */
+	u8		bp_mask[2];
+	void		(*bp_range)(struct spi_flash *flash, u8 sr1, u8 sr2,
+			u32 *start, u32 *len);
+	/*
+	 * Built by the probe from bp_range: the distinct settings, and the row
+	 * of each combination of the bp_mask bits. NULL when unknown.
+	 */
+	struct spi_flash_bp *bp_table;
+	u8		*bp_row;
+	u8		bp_count;
 	int		(*read)(struct spi_flash *flash, u32 offset, size_t len, void *buf);
 	int		(*write)(struct spi_flash *flash, u32 offset, size_t len,
 			const void *buf);
@@ -59,6 +96,12 @@ struct spi_flash {
 	int		(*lock)(struct spi_flash *flash);
 	int		(*unlock)(struct spi_flash *flash);
 	int		(*is_locked)(struct spi_flash *flash);
+	/* Returns 1 if no block protection covers the range */
+	int		(*is_writable)(struct spi_flash *flash, u32 offset,
+			size_t len);
+	/* As lock/unlock, but leave the non-volatile protection bits alone */
+	int		(*lock_volatile)(struct spi_flash *flash);
+	int		(*unlock_volatile)(struct spi_flash *flash);
 	int		(*sec_sts)(struct spi_flash *flash);
 	int		(*sec_read)(struct spi_flash *flash, u32 offset, size_t len, void *buf);
 	int		(*sec_prog)(struct spi_flash *flash, u32 offset, size_t len,
@@ -69,63 +112,121 @@ struct spi_flash {
 
 struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 		unsigned int max_hz, unsigned int spi_mode);
+/* Memory mapped CFI flash, as QEMU emulates it, NULL if there is none */
+struct spi_flash *cfi_flash_probe(void);
 
-static inline int spi_flash_read(struct spi_flash *flash, u32 offset, size_t len, void *buf)
-{
-	return flash->read(flash, offset, len, buf);
-}
+/* Row of bp_table the protection bits in sr1/sr2 select, NULL if unknown */
+const struct spi_flash_bp *spi_flash_bp_lookup(struct spi_flash *flash,
+					       u8 sr1, u8 sr2);
+
+/*
+ * Read from the memory mapped flash below 4 GiB for power-of-two chips up to
+ * 16 MiB, through the controller FIFO otherwise. The FCH ROM decode is not
+ * checked: like coreboot's own boot media code, this assumes firmware
+ * decodes the whole chip, as it does on the APU boards.
+ */
+int spi_flash_read(struct spi_flash *flash, u32 offset, size_t len, void *buf);
 
 static inline int spi_flash_write(struct spi_flash *flash, u32 offset,
 		size_t len, const void *buf)
 {
+	flash->mmap_stale = 1;
 	return flash->write(flash, offset, len, buf);
 }
 
 static inline int spi_flash_erase(struct spi_flash *flash, u32 offset,
 		size_t len)
 {
+	flash->mmap_stale = 1;
 	return flash->spi_erase(flash, offset, len);
 }
 
 static inline int spi_flash_lock(struct spi_flash *flash)
 {
+	if (!flash->lock)
+		return -1;
 	return flash->lock(flash);
 }
 
 static inline int spi_flash_unlock(struct spi_flash *flash)
 {
+	if (!flash->unlock)
+		return -1;
 	return flash->unlock(flash);
 }
 
+static inline int spi_flash_lock_volatile(struct spi_flash *flash)
+{
+	if (!flash->lock_volatile)
+		return -1;
+	return flash->lock_volatile(flash);
+}
+
+static inline int spi_flash_unlock_volatile(struct spi_flash *flash)
+{
+	if (!flash->unlock_volatile)
+		return -1;
+	return flash->unlock_volatile(flash);
+}
+
+/*
+ * Drop the cached status registers, e.g. after another agent may have
+ * written them. Our own status register writes do this already.
+ */
+static inline void spi_flash_sr_invalidate(struct spi_flash *flash)
+{
+	flash->sr_valid = 0;
+}
+
 static inline int spi_flash_is_locked(struct spi_flash *flash)
 {
+	if (!flash->is_locked)
+		return 0;
 	return flash->is_locked(flash);
 }
 
+static inline int spi_flash_is_writable(struct spi_flash *flash, u32 offset,
+		size_t len)
+{
+	if (!flash->is_writable)
+		return !spi_flash_is_locked(flash);
+	return flash->is_writable(flash, offset, len);
+}
+
 static inline int spi_flash_sec_sts(struct spi_flash *flash)
 {
+	if (!flash->sec_sts)
+		return -1;
 	return flash->sec_sts(flash);
 }
 
 static inline int spi_flash_sec_read(struct spi_flash *flash, u32 offset, size_t len,
 		void *buf)
 {
+	if (!flash->sec_read)
+		return -1;
 	return flash->sec_read(flash, offset, len, buf);
 }
 
 static inline int spi_flash_sec_prog(struct spi_flash *flash, u32 offset, size_t len,
 		const void *buf)
 {
+	if (!flash->sec_prog)
+		return -1;
 	return flash->sec_prog(flash, offset, len, buf);
 }
 
 static inline int spi_flash_sec_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
+	if (!flash->sec_erase)
+		return -1;
 	return flash->sec_erase(flash, offset, len);
 }
 
 static inline int spi_flash_sec_lock(struct spi_flash *flash, u8 reg)
 {
+	if (!flash->sec_lock)
+		return -1;
 	return flash->sec_lock(flash, reg);
 }
 
@@ -34,11 +34,18 @@
 #define CMD_READ_ARRAY_FAST		0x0b
 #define CMD_READ_ARRAY_LEGACY		0xe8
 
+#define CMD_READ_SFDP			0x5a
+
 #define CMD_READ_STATUS			0x05
+#define CMD_READ_STATUS2		0x35
+#define CMD_READ_STATUS3		0x15
+#define CMD_WRITE_STATUS		0x01
 #define CMD_WRITE_ENABLE		0x06
+#define CMD_VOLATILE_SR_WRITE_ENABLE	0x50
 
 /* Common status */
 #define STATUS_WIP			0x01
+#define STATUS_WEL			0x02
 
 /* Send a single-byte command to the device and read the response */
 int spi_flash_cmd(struct spi_slave *spi, u8 cmd, void *response, size_t len);
@@ -80,6 +87,62 @@ int spi_flash_cmd_poll_bit(struct spi_flash *flash, unsigned long timeout,
  */
 int spi_flash_cmd_wait_ready(struct spi_flash *flash, unsigned long timeout);
 
+/*
+ * Same as spi_flash_cmd_wait_ready(), but sleep for the typical duration of
+ * the operation first, so the status register is only polled once it is
+ * expected to be done. A known maximum duration can only lengthen the
+ * timeout (in ms), to twice that maximum.
+ */
+int spi_flash_cmd_wait_ready_timed(struct spi_flash *flash, u32 typ_us,
+				   u32 max_us, unsigned long timeout);
+
+/*
+ * Program the flash array with flash->program_cmd, splitting the data on
+ * page and controller FIFO boundaries. The bus is claimed once for the
+ * whole transfer. Used as the ->write() operation of JEDEC parts.
+ */
+int spi_flash_cmd_write_page_program(struct spi_flash *flash, u32 offset,
+				     size_t len, const void *buf);
+
+/*
+ * Non-blocking building blocks for callers that poll the chip themselves.
+ * The caller holds the bus claimed for writing.
+ *
+ * spi_flash_start_erase() issues the erase of the sector at offset with
+ * flash->erase_cmd. spi_flash_start_program() issues one page program of
+ * up to len bytes and returns the number of bytes sent, or a negative
+ * value on error. spi_flash_is_busy() returns 1 while the last one is
+ * still in progress, 0 when done and a negative value on error.
+ */
+int spi_flash_start_erase(struct spi_flash *flash, u32 offset);
+int spi_flash_start_program(struct spi_flash *flash, u32 offset, size_t len,
+			    const void *buf);
+int spi_flash_is_busy(struct spi_flash *flash);
+
+/*
+ * Read status register reg (0 for SR1) from the cache, fetching it from the
+ * chip only when it is not cached. WIP and WEL change on their own and read
+ * as 0 here; poll them with spi_flash_is_busy() or a plain RDSR instead.
+ */
+int spi_flash_read_sr(struct spi_flash *flash, unsigned int reg, u8 *value);
+
+/*
+ * Write len status register bytes starting at SR1 with a single WRSR and
+ * wait for it to finish. With temporary set only the volatile copy of the
+ * bits is written. The cache is dropped, as the chip may ignore the write
+ * while the status register is protected.
+ */
+int spi_flash_write_sr(struct spi_flash *flash, const u8 *sr, size_t len,
+		       int temporary);
+
+/*
+ * bp_range decode of W25Q style parts: SEC=0 protects size/64 doubled for
+ * each BP step, SEC=1 4K doubled up to 32K, BP=7 all. TB moves the block
+ * from the top to the bottom, CMP protects the rest instead.
+ */
+void spi_flash_bp_range_w25q(struct spi_flash *flash, u8 sr1, u8 sr2,
+			     u32 *start, u32 *len);
+
 /* Erase sectors. */
 int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 			u32 offset, size_t len);
@@ -96,3 +159,7 @@ struct spi_flash *spi_flash_probe_winbond(struct spi_slave *spi, u8 *idcode);
 struct spi_flash *spi_flash_probe_gigadevice(struct spi_slave *spi,
 					     u8 *idcode);
 struct spi_flash *spi_fram_probe_ramtron(struct spi_slave *spi, u8 *idcode);
+struct spi_flash *spi_flash_probe_sfdp(struct spi_slave *spi, u8 *idcode);
+
+/* Fill in operation times of an already probed chip from its SFDP tables */
+void spi_flash_sfdp_fill_timings(struct spi_flash *flash);
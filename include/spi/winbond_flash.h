@@ -21,6 +21,7 @@
 #define CMD_W25_RDSR1      0x05	/* Read 1st Status Register */
 #define CMD_W25_RDSR2      0x35	/* Read 2nd Status Register */
 #define CMD_W25_WRSR       0x01	/* Write Status Register */
+#define CMD_W25_VWREN      0x50	/* Write Enable for Volatile Status Register */
 #define CMD_W25_READ       0x03	/* Read Data Bytes */
 #define CMD_W25_FAST_READ  0x0b	/* Read Data Bytes at Higher Speed */
 #define CMD_W25_PP         0x02	/* Page Program */
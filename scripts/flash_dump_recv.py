@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PC Engines GmbH
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# Receives a flash image sent by the sortbootorder flash dump (`D` in the
+# main menu), see utils/flash_dump.c for the protocol. Needs pyserial.
+#
+#   flash_dump_recv.py /dev/ttyUSB0 apu.rom
+#   flash_dump_recv.py --resume /dev/ttyUSB0 apu.rom
+#
+
+import argparse
+import os
+import struct
+import sys
+import time
+import zlib
+
+import serial
+
+FRAME = struct.Struct('<BBHII')
+FRAME_MAGIC = 0xa5
+RAW, RLE, FILL, END = range(4)
+RETRIES = 5
+
+
+class FrameError(Exception):
+    pass
+
+
+def read_exact(port, n):
+    data = port.read(n)
+    if len(data) != n:
+        raise FrameError('timeout')
+    return data
+
+
+def wait_greeting(port, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        line = port.readline()
+        if line.startswith(b'SBODUMP '):
+            version, size, block = (int(x) for x in line.split()[1:4])
+            if version != 1:
+                sys.exit('unsupported protocol version %d' % version)
+            return size, block
+    sys.exit('no SBODUMP greeting, is the main menu shown?')
+
+
+def unrle(data, size):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        n = data[i]
+        if n < 128:
+            out += data[i + 1:i + 2 + n]
+            i += 2 + n
+        else:
+            if i + 1 >= len(data):
+                raise FrameError('truncated run')
+            out += data[i + 1:i + 2] * (n - 125)
+            i += 2
+    if len(out) != size:
+        raise FrameError('bad RLE length')
+    return bytes(out)
+
+
+def read_frame(port, expected, block_size):
+    # Skip whatever is left of the menu or an aborted frame
+    while read_exact(port, 1)[0] != FRAME_MAGIC:
+        pass
+    magic, kind, length, block, crc = FRAME.unpack(
+        bytes([FRAME_MAGIC]) + read_exact(port, FRAME.size - 1))
+    if block != expected:
+        raise FrameError('block %d, expected %d' % (block, expected))
+    if kind == END:
+        return None
+    if length > block_size or kind not in (RAW, RLE, FILL):
+        raise FrameError('bad header')
+    payload = read_exact(port, length)
+    if kind == FILL:
+        data = payload * block_size
+    elif kind == RLE:
+        data = unrle(payload, block_size)
+    else:
+        data = payload
+    if len(data) != block_size or zlib.crc32(data) != crc:
+        raise FrameError('CRC mismatch in block %d' % block)
+    return data
+
+
+def resync(port):
+    # Any byte stops the stream, then drain until the line is quiet
+    port.write(b'\n')
+    time.sleep(0.5)
+    while port.read(4096):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Receive a flash image from the sortbootorder dump')
+    parser.add_argument('port')
+    parser.add_argument('output')
+    parser.add_argument('-b', '--baud', type=int, default=115200)
+    parser.add_argument('--resume', action='store_true',
+                        help='continue a partial image in output')
+    parser.add_argument('--no-enter', action='store_true',
+                        help="dump mode is already entered, don't send D")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=2)
+    if not args.no_enter:
+        port.write(b'D')
+    else:
+        port.write(b'H\n')      # brings back the greeting
+    size, block_size = wait_greeting(port, 10)
+    blocks = size // block_size
+
+    start = 0
+    mode = 'wb'
+    if args.resume and os.path.exists(args.output):
+        start = min(os.path.getsize(args.output) // block_size, blocks)
+        mode = 'r+b'
+
+    with open(args.output, mode) as out:
+        out.truncate(start * block_size)
+        out.seek(start * block_size)
+        block = start
+        retries = 0
+        started = time.monotonic()
+        port.write(b'G %d\n' % block)
+        while True:
+            try:
+                data = read_frame(port, block, block_size)
+            except FrameError as err:
+                retries += 1
+                if retries > RETRIES:
+                    sys.exit('\n%s, giving up, rerun with --resume' % err)
+                print('\n%s, resuming at block %d' % (err, block))
+                resync(port)
+                port.write(b'G %d\n' % block)
+                continue
+            if data is None:
+                break
+            out.write(data)
+            block += 1
+            retries = 0
+            done = (block - start) * block_size
+            rate = done / max(time.monotonic() - started, 0.001)
+            print('\r%3d%% %d KiB/s' % (block * 100 // blocks, rate // 1024),
+                  end='', flush=True)
+
+    port.write(b'Q\n')
+    print('\n%d bytes written to %s' % (size, args.output))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,129 @@
+#!/bin/sh
+#
+# Copyright (C) 2026 PC Engines GmbH
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# Size of every object as linked into the payload, taken from the linker
+# map, so sections dropped by --gc-sections don't count. Fails if text,
+# rodata and data together exceed the budget, 0 means no budget.
+#
+#   size_report.sh <map file> <build dir> <budget in bytes> [lto]
+#
+# With LTO the map only names the linker's temporary objects, so only the
+# totals are printed.
+#
+
+map=$1
+build_dir=$2
+budget=${3:-0}
+lto=${4:-0}
+
+[ -f "$map" ] || { echo "$map not found, link first" >&2; exit 1; }
+
+awk -v build="$build_dir/" -v budget="$budget" -v lto="$lto" '
+function hex(s,    i, n, c) {
+	n = 0
+	s = tolower(substr(s, 3))
+	for (i = 1; i <= length(s); i++) {
+		c = index("0123456789abcdef", substr(s, i, 1)) - 1
+		n = n * 16 + c
+	}
+	return n
+}
+
+function add(obj, col, n) {
+	size[obj, col] += n
+	objs[obj] = 1
+}
+
+function row(name, a, b, c, d) {
+	printf("%-32s %8d %8d %8d %8d\n", name, a, b, c, d)
+}
+
+/^Linker script and memory map/ { mapped = 1; next }
+!mapped { next }
+
+# Long section names go on a line of their own
+NF == 1 && $1 ~ /^[.]/ { name = $1; next }
+
+{
+	if (NF == 3 && $1 ~ /^0x/ && $2 ~ /^0x/) {
+		sec = name; len = $2; file = $3
+	} else if (NF == 4 && $2 ~ /^0x/ && $3 ~ /^0x/) {
+		sec = $1; len = $3; file = $4
+	} else {
+		next
+	}
+	name = ""
+
+	if (sec ~ /^[.]text/)
+		col = 1
+	else if (sec ~ /^[.]rodata/)
+		col = 2
+	else if (sec ~ /^[.]data/)
+		col = 3
+	else if (sec ~ /^[.]bss/ || sec == "COMMON")
+		col = 4
+	else
+		next
+
+	if (lto == 1 && file !~ /libpayload/)
+		file = "(payload, LTO)"
+	else if (index(file, build) == 1)
+		file = substr(file, length(build) + 1)
+	else if (file ~ /libpayload/)
+		file = "(libpayload)"
+	else
+		file = "(other)"
+
+	add(file, col, hex(len))
+}
+
+END {
+	printf("%-32s %8s %8s %8s %8s\n", "object", "text", "rodata", "data", "bss")
+	n = 0
+	for (obj in objs)
+		list[++n] = obj
+	# insertion sort, awk has no portable sort
+	for (i = 2; i <= n; i++)
+		for (j = i; j > 1 && list[j - 1] > list[j]; j--) {
+			t = list[j]; list[j] = list[j - 1]; list[j - 1] = t
+		}
+
+	for (i = 1; i <= n; i++) {
+		obj = list[i]
+		group = obj ~ /\// ? substr(obj, 1, index(obj, "/")) : "(top)"
+		if (obj ~ /^[(]/)
+			group = obj
+		for (c = 1; c <= 4; c++) {
+			g[group, c] += size[obj, c]
+			total[c] += size[obj, c]
+		}
+		groups[group] = 1
+		if (obj !~ /^[(]/)
+			row(obj, size[obj, 1], size[obj, 2], size[obj, 3],
+			    size[obj, 4])
+	}
+
+	print ""
+	for (group in groups)
+		row(group, g[group, 1], g[group, 2], g[group, 3], g[group, 4])
+	row("total", total[1], total[2], total[3], total[4])
+
+	loaded = total[1] + total[2] + total[3]
+	if (budget > 0 && loaded > budget) {
+		printf("\n%d bytes loaded, over the budget of %d by %d\n",
+		       loaded, budget, loaded - budget)
+		exit 1
+	}
+	if (budget > 0)
+		printf("\n%d bytes loaded, budget %d\n", loaded, budget)
+}' "$map"
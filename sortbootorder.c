@@ -17,14 +17,22 @@
  */
 
 #include <boot_device.h>
+#include <boot_scan.h>
+#include <boot_speed_menu.h>
+#include <crc32.h>
 #include <cbfs.h>
 #include <cbfs_glue.h>
 #include <coreboot_tables.h>
 #include <curses.h>
 #include <flash_access.h>
+#include <flash_dump.h>
+#include <flash_queue.h>
 #include <libpayload.h>
+#include <profile.h>
+#include <rom_verify.h>
 #include <rtc_clock_menu.h>
 #include <sec_reg_menu.h>
+#include <spi/spi.h>
 #include <spi/spi_lock_menu.h>
 
 #include "version.h"
@@ -33,6 +41,10 @@
 #define BOOTORDER_FILE     "bootorder"
 #define BOOTORDER_DEF      "bootorder_def"
 #define BOOTORDER_MAP      "bootorder_map"
+#define SCRIPT_FILE        "sortbootorder_script"
+// typed on the console in the main menu, followed by script lines
+#define SCRIPT_MAGIC       "#!sbo"
+#define CONTROL_KEY        0x10	// Ctrl-P, enters the control protocol
 
 // These names come from bootorder_map file
 // indexes depend on device order in this file
@@ -55,10 +67,12 @@
 #define MPCIE1_SATA2      16
 #define IPXE              17
 
-#define WRITE_BYTE_CMD		0x10
-#define READ_ARRAY_CMD		0xFF
-
-#define RESET() outb(0x06, 0x0cf9)
+/* A background erase must not be cut short by the reset */
+#define RESET()					\
+	do {					\
+		flash_queue_wait();		\
+		outb(0x06, 0x0cf9);		\
+	} while (0)
 
 /*** prototypes ***/
 static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
@@ -76,6 +90,7 @@ static int fetch_bootorder_from_cbfs(char destination[MAX_DEVICES][MAX_LENGTH],
 				     u8 *line_count);
 #endif
 static int get_line_number(u8 line_start, u8 line_end, char key);
+static int wait_for_key(void);
 static void int_ids(char buffer[MAX_DEVICES][MAX_LENGTH], u8 line_cnt,
 		    u8 lineDef_cnt );
 static void update_tag_value(char buffer[MAX_DEVICES][MAX_LENGTH],
@@ -84,11 +99,30 @@ static void update_tag_value(char buffer[MAX_DEVICES][MAX_LENGTH],
 static void update_wdg_timeout(char buffer[MAX_DEVICES][MAX_LENGTH],
 			       u8 *max_lines, u16 value);
 #endif
+static void scan_boot_devices(u8 lineDef_cnt);
+static int is_device_absent(const char *line, u8 lineDef_cnt);
+static u8 is_entry_absent(int y, u8 lineDef_cnt);
+static void compact_boot_list(char buffer[MAX_DEVICES][MAX_LENGTH],
+			      u8 max_lines, u8 lineDef_cnt);
 static void update_tags(char bootlist[MAX_DEVICES][MAX_LENGTH], u8 *max_lines);
 static void refresh_tag_values(u8 max_lines);
+static void restore_defaults(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			     u8 max_lines, u8 lineDef_cnt);
+static void move_device_to_top(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			       u8 max_lines, char key);
+static char run_cbfs_script(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			    u8 *max_lines, u8 lineDef_cnt);
+static char run_console_script(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			       u8 *max_lines, u8 lineDef_cnt);
+static char run_control(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			u8 *max_lines, u8 lineDef_cnt);
+static void update_device_toggles(void);
+static int save_settings(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			 u8 *max_lines);
 
 /*** local variables ***/
 static void *flash_address;
+static int no_flash;
 
 static u8 ipxe_toggle;
 static u8 usb_toggle;
@@ -127,6 +161,33 @@ static char id[MAX_DEVICES] = {0};
 
 static u8 device_toggle[MAX_DEVICES];
 static u8 device_hide[MAX_DEVICES] = {0};
+static u8 device_absent[MAX_DEVICES] = {0};
+
+// bootorder tags holding a 0/1 setting, as set by scripts
+struct tag_option {
+	const char *tag;
+	u8 *value;
+};
+
+static const struct tag_option tag_options[] = {
+	{ "pxen", &ipxe_toggle },
+	{ "usben", &usb_toggle },
+	{ "scon", &console_toggle },
+	{ "com2en", &com2_toggle },
+	{ "uartc", &uartc_toggle },
+	{ "uartd", &uartd_toggle },
+#ifndef TARGET_APU1
+	{ "ehcien", &ehci0_toggle },
+	{ "mpcie2_clk", &mpcie2_clk_toggle },
+	{ "boosten", &boost_toggle },
+	{ "sd3mode", &sd3_toggle },
+	{ "pciereverse", &pciereverse_toggle },
+#ifndef COREBOOT_LEGACY
+	{ "iommu", &iommu_toggle },
+	{ "pciepm", &pciepm_toggle },
+#endif
+#endif
+};
 
 /* sortbootorder payload:
  * This payload allows the user to reorder the lines in the bootorder file.
@@ -139,16 +200,15 @@ static u8 device_hide[MAX_DEVICES] = {0};
 
 int main(void) {
 	char bootlist[MAX_DEVICES][MAX_LENGTH];
-	int i;
-	char key;
+	char key, script_key;
 	u8 max_lines = 0;
 	u8 bootlist_def_ln = 0;
 	u8 bootlist_map_ln = 0;
-	u8 line_start = 0;
-	u8 line_number = 0;
 	char *token;
 
+	profile_mark("payload entry");
 	lib_get_sysinfo();
+	profile_mark("lib_get_sysinfo");
 
 	// Set to enabled because enable toggle is not (yet) implemented for these devices
 	device_toggle[SDCARD] = 1;
@@ -160,6 +220,7 @@ int main(void) {
 #ifdef CONFIG_USB /* this needs to be done in order to use the USB keyboard */
 	usb_initialize();
 	noecho(); /* don't echo keystrokes */
+	profile_mark("usb_initialize");
 #endif
 #ifndef COREBOOT_LEGACY
 	struct cb_mainboard* board = (struct cb_mainboard *)lib_sysinfo.cb_mainboard;
@@ -172,13 +233,15 @@ int main(void) {
 		SORTBOOTORDER_VER);
 
 	char *is_qemu = strstr((char*)apu_id_string, "QEMU");
+	no_flash = init_flash();
 
-	if (init_flash() && !is_qemu) {
+	if (no_flash && !is_qemu) {
 		printf("Can't initialize flash device!\n");
 		RESET();
-	} else if (is_qemu) {
-		printf("QEMU detected. SPI flash initialization skipped.\n");
+	} else if (no_flash) {
+		printf("QEMU detected, no CFI flash found. Saving disabled.\n");
 	}
+	profile_mark("init_flash");
 
 	// Find out where the bootorder file is in rom
 #ifdef COREBOOT_LEGACY
@@ -186,6 +249,7 @@ int main(void) {
 	flash_address = (void *)tmp;
 	if ((u32)tmp & 0xfff)
 		printf("Warning: The bootorder file is not 4k aligned!\n");
+	flash_keep_writable((u32)tmp & ~0xfff, 0x1000);
 
 	fetch_file_from_cbfs( BOOTORDER_FILE, bootlist, &max_lines );
 	memcpy(bootorder_data, flash_address, 4096);
@@ -196,9 +260,20 @@ int main(void) {
 		RESET();
 	}
 #endif
+	profile_mark("fetch_bootorder");
+
+#ifdef BOOTORDER_AB
+	// erase the spare slot while the menu waits for a key
+	if (!no_flash)
+		bootorder_ab_prepare();
+#endif
 
 	fetch_file_from_cbfs( BOOTORDER_DEF, bootlist_def, &bootlist_def_ln );
+	profile_mark("fetch " BOOTORDER_DEF);
 	fetch_file_from_cbfs( BOOTORDER_MAP, bootlist_map, &bootlist_map_ln );
+	profile_mark("fetch " BOOTORDER_MAP);
+	scan_boot_devices(bootlist_def_ln);
+	profile_mark("scan_boot_devices");
 
 	// Init ipxe and serial status
 	if (!strncmp((char*) apu_id_string, "apu7", 4)) {
@@ -271,27 +346,37 @@ int main(void) {
 	token = strstr(bootorder_data, "uartd");
 	token += strlen("uartd");
 	uartd_toggle = token ? strtoul(token, NULL, 10) : 0;
+	profile_mark("tag scan");
 
-	if (!is_qemu) {
+	if (!no_flash) {
 		spi_wp_toggle = is_flash_locked();
 	} else {
-		printf("QEMU detected. SPI flash flash lock check skipped.\n");
+		printf("QEMU detected. Flash lock check skipped.\n");
 	}
+	profile_mark("is_flash_locked");
 
-	show_boot_device_list( bootlist, max_lines, bootlist_def_ln );
 	int_ids( bootlist, max_lines, bootlist_def_ln );
 
+	// provisioning, applied without showing the menu
+	script_key = run_cbfs_script(bootlist, &max_lines, bootlist_def_ln);
+	profile_mark("run_cbfs_script");
+	if (!script_key) {
+		show_boot_device_list( bootlist, max_lines, bootlist_def_ln );
+		profile_mark("show_boot_device_list");
+	}
+#ifdef PROFILE_STARTUP
+	profile_print();
+#endif
+
 	// Start main loop for user input
 	while (1) {
-		key = getchar();
+		key = script_key ? script_key : wait_for_key();
+		script_key = 0;
 		printf("%c\n\n\n", key);
 		switch(key) {
 			case 'r':
 			case 'R':
-				for (i = 0; i < max_lines && i < bootlist_def_ln; i++ )
-					copy_list_line(&(bootlist_def[i][0]), &(bootlist[i][0]));
-				int_ids( bootlist, max_lines, bootlist_def_ln );
-				refresh_tag_values(bootlist_def_ln);
+				restore_defaults(bootlist, max_lines, bootlist_def_ln);
 				break;
 			case 'n':
 			case 'N':
@@ -363,52 +448,62 @@ int main(void) {
 				pciepm_toggle ^= 0x1;
 				break;
 #endif
+			case 'B':
+				flash_queue_run();
+				handle_boot_speed_menu();
+				break;
 			case 'Q':
+				flash_queue_run();
 				handle_spi_lock_menu();
 				break;
 			case 'Z':
+				flash_queue_run();
 				handle_reg_sec_menu();
 				break;
 #endif
 			case 'z':
 				handle_rtc_clock_menu();
 				break;
+			case 'D':
+				flash_queue_run();
+				flash_dump();
+				break;
+			case 'F':
+				flash_queue_run();
+				handle_rom_verify();
+				break;
+			case 'A':
+				profile_print();
+				break;
+#ifdef SPI_TRACE_RING
+			case 'E':
+				spi_trace_dump();
+				break;
+#endif
+			case CONTROL_KEY:
+				script_key = run_control(bootlist, &max_lines,
+							 bootlist_def_ln);
+				if (script_key)
+					continue;
+				break;
+			case '#':
+				script_key = run_console_script(bootlist,
+						&max_lines, bootlist_def_ln);
+				if (script_key)
+					continue;
+				break;
+			case 'C':
+				compact_boot_list(bootlist, max_lines,
+						  bootlist_def_ln);
+				show_boot_device_list(bootlist, max_lines,
+						      bootlist_def_ln);
+				__attribute__((fallthrough));
+				// fall through to save ...
 			case 's':
 			case 'S':
-				update_tags(bootlist, &max_lines);
-				if (!is_qemu) {
-					save_flash((u32)flash_address, bootlist,
-					   max_lines, spi_wp_toggle);
-				} else {
-					printf("QEMU detected. save_flash not implemented.\n");
-					// Compact the table into the expected packed list
-					char cbfs_formatted_list[MAX_DEVICES * MAX_LENGTH];
-					int i, j, k = 0;
-					volatile char *ptr;
-					flash_address = (void *)(uintptr_t)(0x100000000ULL - 0x800000);
-					for (j = 0; j < max_lines; j++) {
-						for (k = 0; k < MAX_LENGTH; k++) {
-							cbfs_formatted_list[i++] = bootlist[j][k];
-							if (bootlist[j][k] == NEWLINE )
-								break;
-						}
-					}
-					cbfs_formatted_list[i++] = NUL;
-					printf("Writing %d bytes @ %p\n", i, flash_address);
-					ptr = flash_address;
-
-					for (j = 0; j < i; j++) {
-						write8(ptr, WRITE_BYTE_CMD);
-						write8(ptr, cbfs_formatted_list[j]);
-						ptr++;
-					}
-
-					/* Restore flash to read mode. */
-					if (i > 0) {
-						write8(ptr - 1, READ_ARRAY_CMD);
-					}
-					printf("Done\n");
-				}
+				if (save_settings(bootlist, &max_lines) ==
+				    FLASH_QUEUE_CANCELLED)
+					break;
 				__attribute__((fallthrough));
 				// fall through to exit ...
 			case 'x':
@@ -417,13 +512,8 @@ int main(void) {
 				RESET();
 				break;
 			default:
-				if (key >= 'a' && key <= 'j' ) {
-					line_start = 0;
-					while ((line_number =  get_line_number(line_start, max_lines, key)) > line_start) {
-						move_boot_list( bootlist, line_number , max_lines );
-						line_start++;
-					}
-				}
+				if (key >= 'a' && key <= 'j' )
+					move_device_to_top(bootlist, max_lines, key);
 				break;
 		}
 		show_boot_device_list( bootlist, max_lines, bootlist_def_ln );
@@ -431,6 +521,24 @@ int main(void) {
 	return 0;  /* should never get here! */
 }
 
+/*******************************************************************************/
+static int save_settings(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			 u8 *max_lines)
+{
+	update_tags(bootlist, max_lines);
+
+	if (no_flash) {
+		printf("No flash device, settings not saved\n");
+		return -1;
+	}
+
+	// let a background erase finish first
+	flash_queue_run();
+
+	return save_flash((u32)flash_address, bootlist, *max_lines,
+			  spi_wp_toggle);
+}
+
 /*******************************************************************************/
 static int strcmp_printable_char(const char *s1, const char *s2)
 {
@@ -446,6 +554,16 @@ static int strcmp_printable_char(const char *s1, const char *s2)
 	return res;
 }
 
+/*******************************************************************************/
+static int wait_for_key(void)
+{
+	// keep queued flash jobs going while the user makes up their mind
+	while (!havechar())
+		flash_queue_poll();
+
+	return getchar();
+}
+
 /*******************************************************************************/
 static int get_line_number(u8 line_start, u8 line_end, char key)
 {
@@ -469,12 +587,8 @@ static void copy_list_line(char *src, char *dest)
 }
 
 /*******************************************************************************/
-static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
-				  u8 line_cnt, u8 lineDef_cnt )
+static void update_device_toggles(void)
 {
-	int i,j,y,unique;
-	char print_device[MAX_LENGTH];
-
 	device_toggle[USB_1]  = usb_toggle;
 	device_toggle[USB_2]  = usb_toggle;
 	device_toggle[USB_3]  = usb_toggle;
@@ -488,6 +602,17 @@ static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
 	device_toggle[USB_11] = usb_toggle;
 	device_toggle[USB_12] = usb_toggle;
 	device_toggle[IPXE]   = ipxe_toggle;
+}
+
+/*******************************************************************************/
+static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
+				  u8 line_cnt, u8 lineDef_cnt )
+{
+	int i,j,y,unique;
+	u8 absent;
+	char print_device[MAX_LENGTH];
+
+	update_device_toggles();
 
 	printf("Boot order - type letter to move device to top.\n\n");
 	for (i = 0; i < line_cnt; i++ ) {
@@ -502,9 +627,12 @@ static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
 							unique = 0;
 					}
 					if (unique) {
+						absent = is_entry_absent(y, lineDef_cnt);
 						strcpy(print_device, &bootlist_map[y][0]);
 						print_device[strlen(print_device)-1] = '\0';
-						printf("  %s %s\n", print_device, (device_toggle[y]) ? "" : "(disabled)");
+						printf("  %s %s%s\n", print_device,
+						       (device_toggle[y]) ? "" : "(disabled) ",
+						       absent ? "(not detected)" : "");
 						break;
 					}
 				}
@@ -513,6 +641,7 @@ static void show_boot_device_list(char buffer[MAX_DEVICES][MAX_LENGTH],
 	}
 	printf("\n\n");
 	printf("  r Restore boot order defaults\n");
+	printf("  C Compact boot order - detected devices first, then save and exit\n");
 	if (pxe_available)
 		printf("  n Network/PXE boot - Currently %s\n",
 			(ipxe_toggle) ? "Enabled" : "Disabled");
@@ -568,6 +697,8 @@ static int fetch_bootorder_from_cbfs(char destination[MAX_DEVICES][MAX_LENGTH],
 	void *bootorder_mapping;
 	size_t cbfs_length;
 
+	// the rest of fetch_bootorder() is the CBFS fallback
+	profile_mark("FMAP lookup");
 	bootorder_mapping = cbfs_map(BOOTORDER_FILE, &cbfs_length);
 
 	if (!bootorder_mapping) {
@@ -599,6 +730,9 @@ static int fetch_bootorder(char destination[MAX_DEVICES][MAX_LENGTH],
 	u16 offset = 0, char_cnt = 0;
 	static struct cbfs_boot_device rw;
 	u32 rom_begin = (0xFFFFFFFF - lib_sysinfo.spi_flash.size) + 1;
+#ifdef BOOTORDER_AB
+	int slot;
+#endif
 
 	if (fmap_locate_area("BOOTORDER", &rw.dev.offset, &rw.dev.size)) {
 		printf("BOOTORDER area not found, fetching from CBFS...\n");
@@ -614,6 +748,18 @@ static int fetch_bootorder(char destination[MAX_DEVICES][MAX_LENGTH],
 		return fetch_bootorder_from_cbfs(destination, line_count);
 	}
 
+	// locking leaves the whole area writable, including both A/B slots
+	flash_keep_writable(rw.dev.offset, rw.dev.size);
+
+#ifdef BOOTORDER_AB
+	slot = bootorder_ab_init((u32)flash_address, rw.dev.size);
+	if (slot >= 0) {
+		flash_address = (char *)flash_address + slot;
+		rw.dev.offset += slot;
+		rw.dev.size = sizeof(bootorder_data);
+	}
+#endif
+
 	if (boot_device_read(bootorder_data, rw.dev.offset, rw.dev.size) != rw.dev.size) {
 		printf("Failed to read bootorder data, fetching from CBFS...\n");
 		return fetch_bootorder_from_cbfs(destination, line_count);
@@ -748,6 +894,71 @@ static void move_boot_list(char buffer[MAX_DEVICES][MAX_LENGTH], u8 line,
 	id[0] = ln;
 }
 
+/*******************************************************************************/
+static void scan_boot_devices(u8 lineDef_cnt)
+{
+	int y;
+
+	for (y = 0; y < lineDef_cnt; y++) {
+		if (bootlist_def[y][0] == '/')
+			device_absent[y] = scan_boot_path(&bootlist_def[y][0]) ==
+					   BOOT_PATH_ABSENT;
+	}
+}
+
+/*******************************************************************************/
+/* Lines merged into one bootorder_map entry are absent only as a whole */
+static u8 is_entry_absent(int y, u8 lineDef_cnt)
+{
+	u8 absent = device_absent[y];
+	int j;
+
+	for (j = 0; j < lineDef_cnt; j++) {
+		if (strcmp_printable_char(&bootlist_map[y][0],
+					  &bootlist_map[j][0]) == 0)
+			absent &= device_absent[j];
+	}
+	return absent;
+}
+
+/*******************************************************************************/
+static int is_device_absent(const char *line, u8 lineDef_cnt)
+{
+	int y;
+
+	for (y = 0; y < lineDef_cnt; y++) {
+		if (strcmp_printable_char(line, &(bootlist_def[y][0])) == 0)
+			return is_entry_absent(y, lineDef_cnt);
+	}
+	return 0;
+}
+
+/*******************************************************************************/
+static void compact_boot_list(char buffer[MAX_DEVICES][MAX_LENGTH],
+			      u8 max_lines, u8 lineDef_cnt)
+{
+	char temp_line[MAX_LENGTH];
+	char ln;
+	u8 i, x, top = 0;
+
+	// bring the detected devices up in their current order, absent
+	// ones and the tags stay below
+	for (i = 0; i < max_lines; i++) {
+		if (buffer[i][0] != '/' ||
+		    is_device_absent(&(buffer[i][0]), lineDef_cnt))
+			continue;
+
+		copy_list_line( &(buffer[i][0]), temp_line );
+		ln = id[i];
+		for (x = i; x > top; x--) {
+			copy_list_line( &(buffer[x-1][0]), &(buffer[x][0]) );
+			id[x] = id[x - 1];
+		}
+		copy_list_line(temp_line, &(buffer[top][0]) );
+		id[top++] = ln;
+	}
+}
+
 /*******************************************************************************/
 static void update_tag_value(char buffer[MAX_DEVICES][MAX_LENGTH],
 			     u8 *max_lines, const char * tag, char value)
@@ -920,3 +1131,555 @@ static void refresh_tag_values(u8 max_lines)
 #endif
 	}
 }
+
+/*******************************************************************************/
+static void restore_defaults(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			     u8 max_lines, u8 lineDef_cnt)
+{
+	int i;
+
+	for (i = 0; i < max_lines && i < lineDef_cnt; i++ )
+		copy_list_line(&(bootlist_def[i][0]), &(bootlist[i][0]));
+	int_ids( bootlist, max_lines, lineDef_cnt );
+	refresh_tag_values(lineDef_cnt);
+}
+
+/*******************************************************************************/
+static void move_device_to_top(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			       u8 max_lines, char key)
+{
+	u8 line_start = 0;
+	u8 line_number;
+
+	while ((line_number =  get_line_number(line_start, max_lines, key)) > line_start) {
+		move_boot_list( bootlist, line_number , max_lines );
+		line_start++;
+	}
+}
+
+/*******************************************************************************/
+/* Settings by the name of their bootorder tag, shared by scripts and the
+ * control protocol. wp is the BIOS write protect, watchdog is in seconds.
+ */
+enum option_result {
+	OPTION_OK,
+	OPTION_UNKNOWN,
+	OPTION_RANGE,
+	OPTION_UNAVAILABLE,
+};
+
+static u8 *find_option(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tag_options); i++) {
+		if (!strcmp(name, tag_options[i].tag))
+			return tag_options[i].value;
+	}
+
+	return NULL;
+}
+
+static int option_available(const u8 *value)
+{
+	return (value != &ipxe_toggle || pxe_available) &&
+	       (value != &com2_toggle || com2_available);
+}
+
+static int get_option(const char *name, unsigned long *value)
+{
+	u8 *option;
+
+#ifndef TARGET_APU1
+	if (!strcmp(name, "watchdog")) {
+		*value = wdg_timeout;
+		return OPTION_OK;
+	}
+#endif
+	if (!strcmp(name, "wp")) {
+		*value = spi_wp_toggle;
+		return OPTION_OK;
+	}
+
+	option = find_option(name);
+	if (!option)
+		return OPTION_UNKNOWN;
+	if (!option_available(option))
+		return OPTION_UNAVAILABLE;
+
+	*value = *option;
+	return OPTION_OK;
+}
+
+static int set_option(const char *name, unsigned long value)
+{
+	u8 *option;
+
+#ifndef TARGET_APU1
+	if (!strcmp(name, "watchdog")) {
+		if (value > 0xffff || (value && value < 60))
+			return OPTION_RANGE;
+		wdg_timeout = value;
+		return OPTION_OK;
+	}
+#endif
+	if (!strcmp(name, "wp")) {
+		if (value > 1)
+			return OPTION_RANGE;
+		spi_wp_toggle = value;
+		return OPTION_OK;
+	}
+
+	option = find_option(name);
+	if (!option)
+		return OPTION_UNKNOWN;
+	if (!option_available(option))
+		return OPTION_UNAVAILABLE;
+	if (value > 1)
+		return OPTION_RANGE;
+
+	*option = value;
+	return OPTION_OK;
+}
+
+/* Move devices by letter, the first one ends up on top. Returns 0 or the
+ * letter that is not in the list, before anything is moved.
+ */
+static char apply_order(char bootlist[MAX_DEVICES][MAX_LENGTH], u8 max_lines,
+			const char *list)
+{
+	char keys[MAX_DEVICES];
+	int n = 0, i;
+
+	for (; *list; list++) {
+		if (*list == ',' || *list == ' ')
+			continue;
+		if (n == MAX_DEVICES || !memchr(id, *list, max_lines))
+			return *list;
+		keys[n++] = *list;
+	}
+
+	for (i = n - 1; i >= 0; i--)
+		move_device_to_top(bootlist, max_lines, keys[i]);
+
+	return 0;
+}
+
+/*******************************************************************************/
+/* Script commands, one per line:
+ *     order: b,c,a    boot devices by bootorder_map letter, first on top
+ *     <tag>=0|1       bootorder tag, e.g. pxen=0
+ *     watchdog=<s>    watchdog timeout in seconds, 0 disables
+ *     wp=0|1          BIOS write protect
+ *     restore         boot order defaults
+ *     compact         detected devices first
+ *     save / exit     save and reset / reset without saving
+ *     end             back to the interactive menu
+ * Empty lines and lines starting with '#' are skipped.
+ */
+enum script_result {
+	SCRIPT_NEXT,
+	SCRIPT_SAVE,
+	SCRIPT_EXIT,
+	SCRIPT_END,
+	SCRIPT_ERROR,
+};
+
+static int script_order(char bootlist[MAX_DEVICES][MAX_LENGTH], u8 max_lines,
+			const char *list)
+{
+	char bad = apply_order(bootlist, max_lines, list);
+
+	if (bad) {
+		printf("Unknown boot device '%c'\n", bad);
+		return SCRIPT_ERROR;
+	}
+
+	return SCRIPT_NEXT;
+}
+
+static int script_set(char *name, const char *arg)
+{
+	unsigned long value;
+	char *end;
+
+	value = strtoul(arg, &end, 10);
+	if (end == arg || *end) {
+		printf("Bad value '%s'\n", arg);
+		return SCRIPT_ERROR;
+	}
+
+	switch (set_option(name, value)) {
+	case OPTION_OK:
+		return SCRIPT_NEXT;
+	case OPTION_RANGE:
+		if (!strcmp(name, "watchdog"))
+			printf("watchdog: minimum 60 or 0 to disable\n");
+		else
+			printf("%s: 0 or 1 expected\n", name);
+		break;
+	case OPTION_UNAVAILABLE:
+		printf("%s is not available on this board\n", name);
+		break;
+	default:
+		printf("Unknown setting '%s'\n", name);
+		break;
+	}
+
+	return SCRIPT_ERROR;
+}
+
+static int run_script_line(const char *text,
+			   char bootlist[MAX_DEVICES][MAX_LENGTH],
+			   u8 *max_lines, u8 lineDef_cnt)
+{
+	char line[MAX_LENGTH];
+	char *eq;
+	int len;
+
+	while (*text == ' ' || *text == '\t')
+		text++;
+	strncpy(line, text, sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\0';
+	for (len = strlen(line); len && line[len - 1] <= ' '; len--)
+		line[len - 1] = '\0';
+
+	if (!line[0] || line[0] == '#')
+		return SCRIPT_NEXT;
+	if (!strcmp(line, "save"))
+		return SCRIPT_SAVE;
+	if (!strcmp(line, "exit"))
+		return SCRIPT_EXIT;
+	if (!strcmp(line, "end"))
+		return SCRIPT_END;
+
+	if (!strcmp(line, "restore")) {
+		restore_defaults(bootlist, *max_lines, lineDef_cnt);
+		return SCRIPT_NEXT;
+	}
+	if (!strcmp(line, "compact")) {
+		compact_boot_list(bootlist, *max_lines, lineDef_cnt);
+		return SCRIPT_NEXT;
+	}
+	if (!strncmp(line, "order:", strlen("order:")))
+		return script_order(bootlist, *max_lines,
+				    line + strlen("order:"));
+
+	eq = strchr(line, '=');
+	if (!eq) {
+		printf("Unknown command '%s'\n", line);
+		return SCRIPT_ERROR;
+	}
+	*eq = '\0';
+
+	return script_set(line, eq + 1);
+}
+
+/* What a save would write, to skip saving a script that changes nothing */
+static u32 settings_crc(char bootlist[MAX_DEVICES][MAX_LENGTH], u8 *max_lines)
+{
+	u32 crc;
+	int i;
+
+	update_tags(bootlist, max_lines);
+
+	crc = crc32_update(0, &spi_wp_toggle, sizeof(spi_wp_toggle));
+	for (i = 0; i < *max_lines; i++)
+		crc = crc32_update(crc, &bootlist[i][0],
+				   strcspn(&bootlist[i][0], "\n"));
+
+	return crc;
+}
+
+/* Main loop key to act on the script's last command */
+static char script_action(int ret)
+{
+	switch (ret) {
+	case SCRIPT_SAVE:
+		return 's';
+	case SCRIPT_EXIT:
+		return 'x';
+	case SCRIPT_ERROR:
+		printf("Script stopped, nothing saved\n");
+		__attribute__((fallthrough));
+	default:
+		return 0;
+	}
+}
+
+/*******************************************************************************/
+static char run_cbfs_script(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			    u8 *max_lines, u8 lineDef_cnt)
+{
+	char line[MAX_LENGTH];
+	char *script, *p, *end;
+	size_t size, n;
+	int ret = SCRIPT_END, line_no = 0;
+	u32 crc;
+
+	script = cbfs_map(SCRIPT_FILE, &size);
+	if (!script)
+		return 0;
+
+	printf("Running %s\n", SCRIPT_FILE);
+	crc = settings_crc(bootlist, max_lines);
+
+	for (p = script, end = script + size; p < end && *p; ) {
+		for (n = 0; p < end && *p && *p != NEWLINE; p++) {
+			if (n < sizeof(line) - 1)
+				line[n++] = *p;
+		}
+		line[n] = '\0';
+		if (p < end && *p == NEWLINE)
+			p++;
+		line_no++;
+
+		ret = run_script_line(line, bootlist, max_lines, lineDef_cnt);
+		if (ret != SCRIPT_NEXT)
+			break;
+	}
+
+	cbfs_unmap(script);
+
+	if (ret == SCRIPT_ERROR)
+		printf("%s line %d\n", SCRIPT_FILE, line_no);
+
+	// the file stays in CBFS, don't save and reset on every entry
+	if (ret == SCRIPT_SAVE && crc == settings_crc(bootlist, max_lines)) {
+		printf("Settings already match %s\n", SCRIPT_FILE);
+		return 0;
+	}
+
+	return script_action(ret);
+}
+
+/*******************************************************************************/
+static char run_console_script(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			       u8 *max_lines, u8 lineDef_cnt)
+{
+	char *line;
+	int ret;
+
+	// '#' has been read already
+	line = readline("");
+	ret = strncmp(line, SCRIPT_MAGIC + 1, strlen(SCRIPT_MAGIC) - 1);
+	line[0] = '\0';
+	if (ret)
+		return 0;
+
+	do {
+		line = readline("");
+		ret = run_script_line(line, bootlist, max_lines, lineDef_cnt);
+		line[0] = '\0';
+	} while (ret == SCRIPT_NEXT);
+
+	return script_action(ret);
+}
+
+/*******************************************************************************/
+/* Control protocol, for management hosts:
+ *     LIST              B <letter> <enabled> <detected> <name> per boot
+ *                       device in boot order, then T <name> <value> per
+ *                       setting, then OK
+ *     GET <name>        OK <name>=<value>
+ *     SET <name>=<value>
+ *     ORDER [letters]   reorder like a script, OK <current order>
+ *     VERIFY            V <region> <result> per manifest line, then OK
+ *                       or ERR MISMATCH
+ *     SAVE              save, then OK and reset, or ERR UNAVAILABLE if
+ *                       there is no flash or ERR FAILED
+ *     EXIT              back to the menu
+ * Every reply line ends in '*' and the CRC32 of the text before it, the
+ * save progress lines have no CRC.
+ * Errors are ERR UNKNOWN, ERR RANGE, ERR UNAVAILABLE, ERR SYNTAX,
+ * ERR MISMATCH or ERR FAILED.
+ */
+static void control_reply(const char *fmt, ...)
+{
+	char line[MAX_LENGTH * 2];
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+	if (len >= sizeof(line))
+		len = sizeof(line) - 1;
+
+	printf("%s*%08x\n", line, crc32_update(0, line, len));
+}
+
+/* Read a command line without echo */
+static void control_read(char *line, int size)
+{
+	int len = 0;
+	int c;
+
+	while (1) {
+		c = wait_for_key();
+		if (c == '\r' || c == '\n') {
+			if (len)
+				break;
+			continue;
+		}
+		if (len < size - 1)
+			line[len++] = c;
+	}
+	line[len] = '\0';
+}
+
+static void control_verify_region(const char *region, int result,
+				  const u8 *digest)
+{
+	static const char *const names[] = {
+		[ROM_REGION_OK]		= "OK",
+		[ROM_REGION_MISMATCH]	= "MISMATCH",
+		[ROM_REGION_MISSING]	= "MISSING",
+		[ROM_REGION_INVALID]	= "INVALID",
+		[ROM_REGION_UNREADABLE]	= "UNREADABLE",
+	};
+
+	control_reply("V %s %s", region, names[result]);
+}
+
+static void control_option_error(int ret)
+{
+	switch (ret) {
+	case OPTION_RANGE:
+		control_reply("ERR RANGE");
+		break;
+	case OPTION_UNAVAILABLE:
+		control_reply("ERR UNAVAILABLE");
+		break;
+	default:
+		control_reply("ERR UNKNOWN");
+		break;
+	}
+}
+
+static void control_order(u8 max_lines)
+{
+	char order[MAX_DEVICES + 1];
+	int i, n = 0;
+
+	for (i = 0; i < max_lines; i++) {
+		if (id[i] && !memchr(order, id[i], n))
+			order[n++] = id[i];
+	}
+	order[n] = '\0';
+
+	control_reply("OK %s", order);
+}
+
+static void control_list(char bootlist[MAX_DEVICES][MAX_LENGTH], u8 max_lines,
+			 u8 lineDef_cnt)
+{
+	char name[MAX_LENGTH];
+	char listed[MAX_DEVICES];
+	unsigned long value;
+	int i, y, n = 0;
+
+	update_device_toggles();
+
+	for (i = 0; i < max_lines; i++) {
+		if (!id[i] || memchr(listed, id[i], n))
+			continue;
+		for (y = 0; y < lineDef_cnt; y++) {
+			if (!device_hide[y] && strcmp_printable_char(
+			    &(bootlist[i][0]), &(bootlist_def[y][0])) == 0)
+				break;
+		}
+		if (y == lineDef_cnt)
+			continue;
+
+		listed[n++] = id[i];
+		strncpy(name, &bootlist_map[y][2], sizeof(name) - 1);
+		name[sizeof(name) - 1] = '\0';
+		name[strcspn(name, "\r\n")] = '\0';
+		control_reply("B %c %d %d %s", id[i], device_toggle[y],
+			      !is_entry_absent(y, lineDef_cnt), name);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tag_options); i++) {
+		if (get_option(tag_options[i].tag, &value) == OPTION_OK)
+			control_reply("T %s %lu", tag_options[i].tag, value);
+	}
+#ifndef TARGET_APU1
+	control_reply("T watchdog %u", wdg_timeout);
+#endif
+	control_reply("T wp %u", spi_wp_toggle);
+	control_reply("OK");
+}
+
+static char run_control(char bootlist[MAX_DEVICES][MAX_LENGTH],
+			u8 *max_lines, u8 lineDef_cnt)
+{
+	char line[MAX_LENGTH];
+	unsigned long value;
+	char *arg, *eq, *end;
+	int ret;
+
+	control_reply("SBO %s", SORTBOOTORDER_VER);
+
+	while (1) {
+		control_read(line, sizeof(line));
+
+		arg = strchr(line, ' ');
+		if (arg)
+			*arg++ = '\0';
+
+		if (!strcmp(line, "LIST")) {
+			control_list(bootlist, *max_lines, lineDef_cnt);
+		} else if (!strcmp(line, "GET") && arg) {
+			ret = get_option(arg, &value);
+			if (ret == OPTION_OK)
+				control_reply("OK %s=%lu", arg, value);
+			else
+				control_option_error(ret);
+		} else if (!strcmp(line, "SET") && arg && (eq = strchr(arg, '='))) {
+			*eq = '\0';
+			value = strtoul(eq + 1, &end, 10);
+			if (end == eq + 1 || *end) {
+				control_reply("ERR SYNTAX");
+				continue;
+			}
+			ret = set_option(arg, value);
+			if (ret == OPTION_OK)
+				control_reply("OK");
+			else
+				control_option_error(ret);
+		} else if (!strcmp(line, "ORDER")) {
+			if (arg && apply_order(bootlist, *max_lines, arg))
+				control_reply("ERR UNKNOWN");
+			else
+				control_order(*max_lines);
+		} else if (!strcmp(line, "VERIFY")) {
+			// no key reads, they would eat the next command
+			flash_queue_wait();
+			ret = rom_verify(control_verify_region);
+			if (ret < 0)
+				control_reply("ERR UNAVAILABLE");
+			else if (ret)
+				control_reply("ERR MISMATCH");
+			else
+				control_reply("OK");
+		} else if (!strcmp(line, "SAVE")) {
+			if (no_flash) {
+				control_reply("ERR UNAVAILABLE");
+				continue;
+			}
+			if (save_settings(bootlist, max_lines)) {
+				control_reply("ERR FAILED");
+				continue;
+			}
+			control_reply("OK");
+			// saved already, only the reset is left
+			return 'x';
+		} else if (!strcmp(line, "EXIT")) {
+			control_reply("OK");
+			return 0;
+		} else {
+			control_reply("ERR SYNTAX");
+		}
+	}
+}
@@ -61,12 +61,6 @@ struct adesto_spi_flash {
 	const struct adesto_spi_flash_params *params;
 };
 
-static inline struct adesto_spi_flash *
-to_adesto_spi_flash(struct spi_flash *flash)
-{
-	return container_of(flash, struct adesto_spi_flash, flash);
-}
-
 static const struct adesto_spi_flash_params adesto_spi_flash_table[] = {
 	{
 		.id			= 0x4218,
@@ -174,69 +168,6 @@ static const struct adesto_spi_flash_params adesto_spi_flash_table[] = {
 	},
 };
 
-static int adesto_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
-{
-	struct adesto_spi_flash *stm = to_adesto_spi_flash(flash);
-	unsigned long byte_addr;
-	unsigned long page_size;
-	size_t chunk_len;
-	size_t actual;
-	int ret;
-	u8 cmd[4];
-
-	page_size = min(1 << stm->params->l2_page_size, CONTROLLER_PAGE_LIMIT);
-	byte_addr = offset % page_size;
-
-	flash->spi->rw = SPI_WRITE_FLAG;
-	ret = spi_claim_bus(flash->spi);
-	if (ret) {
-		spi_debug("SF: Unable to claim SPI bus\n");
-		return ret;
-	}
-
-	for (actual = 0; actual < len; actual += chunk_len) {
-		chunk_len = min(len - actual, page_size - byte_addr);
-
-		cmd[0] = CMD_AT25DF_PP;
-		cmd[1] = (offset >> 16) & 0xff;
-		cmd[2] = (offset >> 8) & 0xff;
-		cmd[3] = offset & 0xff;
-
-		spi_debug("PP: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x }"
-		        " chunk_len = %u\n", buf + actual,
-			cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
-
-		ret = spi_flash_cmd(flash->spi, CMD_AT25DF_WREN, NULL, 0);
-		if (ret < 0) {
-			spi_debug("SF: Enabling Write failed\n");
-			goto out;
-		}
-
-		ret = spi_flash_cmd_write(flash->spi, cmd, 4,
-				buf + actual, chunk_len);
-		if (ret < 0) {
-			spi_debug("SF: Adesto Page Program failed\n");
-			goto out;
-		}
-
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret)
-			goto out;
-
-		offset += chunk_len;
-		byte_addr = 0;
-	}
-
-	spi_debug("SF: Adesto: Successfully programmed %u bytes @"
-			" 0x%lx\n", len, (unsigned long)(offset - len));
-
-	ret = 0;
-
-out:
-	spi_release_bus(flash->spi);
-	return ret;
-}
-
 static int adesto_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
 	return spi_flash_cmd_erase(flash, CMD_AT25DF_SE, offset, len);
@@ -245,7 +176,6 @@ static int adesto_erase(struct spi_flash *flash, u32 offset, size_t len)
 static int adesto_set_lock_flags(struct spi_flash *flash, int lock)
 {
 	int ret;
-	u8 cmd;
 	u8 status[2];
 
 	flash->spi->rw = SPI_WRITE_FLAG;
@@ -255,13 +185,13 @@ static int adesto_set_lock_flags(struct spi_flash *flash, int lock)
 		return ret;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_AT25DF_RDSR1, &status[0], 1);
+	ret = spi_flash_read_sr(flash, 0, &status[0]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 1\n");
 		goto out;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_AT25DF_RDSR2, &status[1], 1);
+	ret = spi_flash_read_sr(flash, 1, &status[1]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 2\n");
 		goto out;
@@ -276,19 +206,7 @@ static int adesto_set_lock_flags(struct spi_flash *flash, int lock)
 	status[0] &= ~(REG_W25_SEC | REG_W25_TB);
 	status[1] &= ~(REG_W25_SRP1 | REG_W25_CMP);
 
-	ret = spi_flash_cmd(flash->spi, CMD_AT25DF_WREN, NULL, 0);
-	if (ret < 0) {
-		spi_debug("SF: Enabling Write failed\n");
-		goto out;
-	}
-
-	cmd = CMD_AT25DF_WRSR1;
-	ret = spi_flash_cmd_write(flash->spi, &cmd, sizeof(cmd),
-				  status, sizeof(status));
-	if (ret < 0) {
-		spi_debug("SF: Status register write failed\n");
-		goto out;
-	}
+	ret = spi_flash_write_sr(flash, status, sizeof(status), 0);
 
 out:
 	spi_release_bus(flash->spi);
@@ -309,7 +227,7 @@ static int adesto_is_locked(struct spi_flash *flash)
 {
 	u8 status = 0;
 
-	spi_flash_cmd(flash->spi, CMD_AT25DF_RDSR1, &status, 1);
+	spi_flash_read_sr(flash, 0, &status);
 
 	if ((status & (REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0))
 	           == (REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0)) {
@@ -338,7 +256,7 @@ struct spi_flash *spi_flash_probe_adesto(struct spi_slave *spi, u8 *idcode)
 		return NULL;
 	}
 
-	stm = malloc(sizeof(struct adesto_spi_flash));
+	stm = calloc(1, sizeof(struct adesto_spi_flash));
 	if (!stm) {
 		spi_debug("SF: Failed to allocate memory\n");
 		return NULL;
@@ -351,8 +269,11 @@ struct spi_flash *spi_flash_probe_adesto(struct spi_slave *spi, u8 *idcode)
 	/* Assuming power-of-two page size initially. */
 	page_size = 1 << params->l2_page_size;
 
-	stm->flash.write = adesto_write;
+	stm->flash.write = spi_flash_cmd_write_page_program;
+	stm->flash.page_size = page_size;
+	stm->flash.program_cmd = CMD_AT25DF_PP;
 	stm->flash.spi_erase = adesto_erase;
+	stm->flash.erase_cmd = CMD_AT25DF_SE;
 	stm->flash.lock = adesto_lock;
 	stm->flash.unlock = adesto_unlock;
 	stm->flash.is_locked = adesto_is_locked;
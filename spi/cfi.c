@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Intel/Sharp command set (CFI 0x0001) parallel flash as QEMU emulates it
+ * with -drive if=pflash, mapped right below 4 GiB. It is driven through the
+ * struct spi_flash operations so saving works the same as on SPI flash.
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <spi/spi_flash.h>
+
+#define CFI_CMD_PROGRAM		0x40
+#define CFI_CMD_CLEAR_STATUS	0x50
+#define CFI_CMD_BLOCK_ERASE	0x20
+#define CFI_CMD_QUERY		0x98
+#define CFI_CMD_CONFIRM		0xd0
+#define CFI_CMD_WRITE_BUFFER	0xe8
+#define CFI_CMD_READ_ARRAY	0xff
+
+#define CFI_QUERY_ADDR		0x55
+/* Query table, x8 addressing */
+#define CFI_QRY			0x10
+#define CFI_DEVICE_SIZE		0x27	/* log2 of the size */
+#define CFI_BUFFER_SIZE		0x2a	/* log2 of the write buffer, 16 bits */
+#define CFI_ERASE_REGIONS	0x2c
+#define CFI_REGION_BLOCK_SIZE	0x2f	/* in 256 byte units, 16 bits */
+
+#define CFI_STATUS_READY	0x80
+/* Erase, program, VPP and block lock errors */
+#define CFI_STATUS_ERRORS	0x3a
+
+#define CFI_TIMEOUT_US		5000000
+/* spi_flash_read() only uses the memory mapped view up to this size */
+#define CFI_MMAP_MAX		(16 * 1024 * 1024)
+
+static struct spi_flash cfi_flash;
+static u8 *cfi_rom;
+static u32 cfi_buffer_size;
+
+static inline u8 cfi_query(const u8 *top, unsigned int reg)
+{
+	return read8(top + reg);
+}
+
+/* Status reads go to any address while the command is running */
+static int cfi_wait(u32 offset)
+{
+	u64 start = timer_us(0);
+	u8 status;
+
+	do {
+		status = read8(cfi_rom + offset);
+		if (status & CFI_STATUS_READY)
+			break;
+	} while (timer_us(start) < CFI_TIMEOUT_US);
+
+	if (status & CFI_STATUS_ERRORS)
+		write8(cfi_rom + offset, CFI_CMD_CLEAR_STATUS);
+	write8(cfi_rom + offset, CFI_CMD_READ_ARRAY);
+
+	if (!(status & CFI_STATUS_READY) || (status & CFI_STATUS_ERRORS)) {
+		spi_debug("CFI: status 0x%02x @ 0x%x\n", status, offset);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Write to buffer reports in bit 7 whether a buffer is free, else retry */
+static int cfi_wait_buffer(u32 offset)
+{
+	u64 start = timer_us(0);
+
+	while (!(read8(cfi_rom + offset) & CFI_STATUS_READY)) {
+		if (timer_us(start) >= CFI_TIMEOUT_US) {
+			write8(cfi_rom + offset, CFI_CMD_READ_ARRAY);
+			return -1;
+		}
+		write8(cfi_rom + offset, CFI_CMD_WRITE_BUFFER);
+	}
+
+	return 0;
+}
+
+static int cfi_read(struct spi_flash *flash, u32 offset, size_t len,
+		    void *buf)
+{
+	offset &= flash->size - 1;
+	if (len > flash->size - offset)
+		return -1;
+
+	memcpy(buf, cfi_rom + offset, len);
+	return 0;
+}
+
+static int cfi_erase(struct spi_flash *flash, u32 offset, size_t len)
+{
+	offset &= flash->size - 1;
+	if (offset % flash->sector_size || len % flash->sector_size ||
+	    len > flash->size - offset)
+		return -1;
+
+	for (; len; offset += flash->sector_size, len -= flash->sector_size) {
+		write8(cfi_rom + offset, CFI_CMD_BLOCK_ERASE);
+		write8(cfi_rom + offset, CFI_CMD_CONFIRM);
+		if (cfi_wait(offset))
+			return -1;
+	}
+
+	/* Nothing caches or prefetches the emulated flash */
+	flash->mmap_stale = 0;
+	return 0;
+}
+
+static int cfi_write(struct spi_flash *flash, u32 offset, size_t len,
+		     const void *buf)
+{
+	const u8 *src = buf;
+	size_t chunk, i;
+
+	offset &= flash->size - 1;
+	if (len > flash->size - offset)
+		return -1;
+
+	for (; len; offset += chunk, src += chunk, len -= chunk) {
+		if (cfi_buffer_size < 2) {
+			chunk = 1;
+			write8(cfi_rom + offset, CFI_CMD_PROGRAM);
+			write8(cfi_rom + offset, *src);
+		} else {
+			/* A buffer write stays within one buffer sized line */
+			chunk = min(len, cfi_buffer_size -
+				    offset % cfi_buffer_size);
+			write8(cfi_rom + offset, CFI_CMD_WRITE_BUFFER);
+			if (cfi_wait_buffer(offset))
+				return -1;
+			write8(cfi_rom + offset, chunk - 1);
+			for (i = 0; i < chunk; i++)
+				write8(cfi_rom + offset + i, src[i]);
+			write8(cfi_rom + offset, CFI_CMD_CONFIRM);
+		}
+
+		if (cfi_wait(offset))
+			return -1;
+	}
+
+	flash->mmap_stale = 0;
+	return 0;
+}
+
+struct spi_flash *cfi_flash_probe(void)
+{
+	/* Query data repeats every 256 bytes, so ask at the top of 4 GiB */
+	u8 *top = phys_to_virt(0x100000000ULL - 0x100);
+	u32 size, block;
+	u8 size_log2, buffer_log2, regions;
+
+	write8(top + CFI_QUERY_ADDR, CFI_CMD_QUERY);
+
+	if (cfi_query(top, CFI_QRY) != 'Q' ||
+	    cfi_query(top, CFI_QRY + 1) != 'R' ||
+	    cfi_query(top, CFI_QRY + 2) != 'Y') {
+		write8(top, CFI_CMD_READ_ARRAY);
+		return NULL;
+	}
+
+	size_log2 = cfi_query(top, CFI_DEVICE_SIZE);
+	buffer_log2 = cfi_query(top, CFI_BUFFER_SIZE);
+	regions = cfi_query(top, CFI_ERASE_REGIONS);
+	block = (cfi_query(top, CFI_REGION_BLOCK_SIZE) |
+		 cfi_query(top, CFI_REGION_BLOCK_SIZE + 1) << 8) * 256;
+	write8(top, CFI_CMD_READ_ARRAY);
+
+	if (size_log2 < 12 || size_log2 >= 32 ||
+	    (1UL << size_log2) > CFI_MMAP_MAX) {
+		spi_debug("CFI: unsupported size 2^%u\n", size_log2);
+		return NULL;
+	}
+	size = 1 << size_log2;
+
+	/* Uniform blocks only, 0 in the table means 128 bytes */
+	if (regions != 1) {
+		spi_debug("CFI: %u erase block regions\n", regions);
+		return NULL;
+	}
+	if (!block)
+		block = 128;
+
+	cfi_rom = phys_to_virt(0x100000000ULL - size);
+	cfi_buffer_size = buffer_log2 && buffer_log2 < 16 ?
+			  1 << buffer_log2 : 0;
+
+	memset(&cfi_flash, 0, sizeof(cfi_flash));
+	cfi_flash.name = "CFI";
+	cfi_flash.size = size;
+	cfi_flash.sector_size = block;
+	cfi_flash.page_size = cfi_buffer_size ? cfi_buffer_size : 1;
+	/* No split operations, the flash queue runs the blocking ones */
+	cfi_flash.read = cfi_read;
+	cfi_flash.write = cfi_write;
+	cfi_flash.spi_erase = cfi_erase;
+
+	spi_debug("CFI: %u KiB, %u byte blocks, %u byte write buffer\n",
+		  size >> 10, block, cfi_buffer_size);
+
+	return &cfi_flash;
+}
@@ -60,12 +60,6 @@ struct gigadevice_spi_flash {
 	const struct gigadevice_spi_flash_params *params;
 };
 
-static inline struct gigadevice_spi_flash *
-to_gigadevice_spi_flash(struct spi_flash *flash)
-{
-	return container_of(flash, struct gigadevice_spi_flash, flash);
-}
-
 static const struct gigadevice_spi_flash_params gigadevice_spi_flash_table[] = {
 	{
 		.id			= 0x4014,
@@ -117,71 +111,6 @@ static const struct gigadevice_spi_flash_params gigadevice_spi_flash_table[] = {
 	},
 };
 
-static int gigadevice_write(struct spi_flash *flash, u32 offset,
-			    size_t len, const void *buf)
-{
-	struct gigadevice_spi_flash *stm = to_gigadevice_spi_flash(flash);
-	unsigned long byte_addr;
-	unsigned long page_size;
-	size_t chunk_len;
-	size_t actual;
-	int ret;
-	u8 cmd[4];
-
-	page_size = min(1 << stm->params->l2_page_size, CONTROLLER_PAGE_LIMIT);
-	byte_addr = offset % page_size;
-
-	flash->spi->rw = SPI_WRITE_FLAG;
-	ret = spi_claim_bus(flash->spi);
-	if (ret) {
-		spi_debug("SF gigadevice.c: Unable to claim SPI bus\n");
-		return ret;
-	}
-
-	for (actual = 0; actual < len; actual += chunk_len) {
-		chunk_len = min(len - actual, page_size - byte_addr);
-
-		ret = spi_flash_cmd(flash->spi, CMD_GD25_WREN, NULL, 0);
-		if (ret < 0) {
-			spi_debug("SF gigadevice.c: Enabling Write failed\n");
-			goto out;
-		}
-
-		cmd[0] = CMD_GD25_PP;
-		cmd[1] = (offset >> 16) & 0xff;
-		cmd[2] = (offset >> 8) & 0xff;
-		cmd[3] = offset & 0xff;
-
-		spi_debug(
-		       "PP gigadevice.c: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x }"
-		       " chunk_len = %u\n", buf + actual,
-		       cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
-
-		ret = spi_flash_cmd_write(flash->spi, cmd, 4,
-					  buf + actual, chunk_len);
-		if (ret < 0) {
-			spi_debug("SF gigadevice.c: Page Program failed\n");
-			goto out;
-		}
-
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret)
-			goto out;
-
-		offset += chunk_len;
-		byte_addr = 0;
-	}
-
-	spi_debug(
-	       "SF gigadevice.c: Successfully programmed %u bytes @ %#x\n",
-	       len, (unsigned int)(offset - len));
-	ret = 0;
-
-out:
-	spi_release_bus(flash->spi);
-	return ret;
-}
-
 static int gigadevice_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
 	return spi_flash_cmd_erase(flash, CMD_GD25_SE, offset, len);
@@ -206,7 +135,7 @@ struct spi_flash *spi_flash_probe_gigadevice(struct spi_slave *spi, u8 *idcode)
 		return NULL;
 	}
 
-	stm = malloc(sizeof(struct gigadevice_spi_flash));
+	stm = calloc(1, sizeof(struct gigadevice_spi_flash));
 	if (!stm) {
 		spi_debug("SF gigadevice.c: Failed to allocate memory\n");
 		return NULL;
@@ -219,8 +148,15 @@ struct spi_flash *spi_flash_probe_gigadevice(struct spi_slave *spi, u8 *idcode)
 	/* Assuming power-of-two page size initially. */
 	page_size = 1 << params->l2_page_size;
 
-	stm->flash.write = gigadevice_write;
+	stm->flash.write = spi_flash_cmd_write_page_program;
+	stm->flash.page_size = page_size;
+	stm->flash.program_cmd = CMD_GD25_PP;
 	stm->flash.spi_erase = gigadevice_erase;
+	stm->flash.erase_cmd = CMD_GD25_SE;
+	/* Same BP4-0 (SEC, TB, BP2-0) and CMP layout as the W25Q parts */
+	stm->flash.bp_range = spi_flash_bp_range_w25q;
+	stm->flash.bp_mask[0] = 0x7c;
+	stm->flash.bp_mask[1] = 0x40;
 #if CONFIG_SPI_FLASH_NO_FAST_READ
 	stm->flash.read = spi_flash_cmd_read_slow;
 #else
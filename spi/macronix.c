@@ -72,11 +72,6 @@ struct macronix_spi_flash {
 	const struct macronix_spi_flash_params *params;
 };
 
-static inline struct macronix_spi_flash *to_macronix_spi_flash(struct spi_flash *flash)
-{
-	return container_of(flash, struct macronix_spi_flash, flash);
-}
-
 static const struct macronix_spi_flash_params macronix_spi_flash_table[] = {
 	{
 		.idcode = 0x2015,
@@ -128,70 +123,32 @@ static const struct macronix_spi_flash_params macronix_spi_flash_table[] = {
 	},
 };
 
-static int macronix_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
+static int macronix_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	struct macronix_spi_flash *mcx = to_macronix_spi_flash(flash);
-	unsigned long byte_addr;
-	unsigned long page_size;
-	size_t chunk_len;
-	size_t actual;
-	int ret;
-	u8 cmd[4];
-
-	page_size = min(mcx->params->page_size, CONTROLLER_PAGE_LIMIT);
-	byte_addr = offset % page_size;
-
-	flash->spi->rw = SPI_WRITE_FLAG;
-	ret = spi_claim_bus(flash->spi);
-	if (ret) {
-		spi_debug("SF: Unable to claim SPI bus\n");
-		return ret;
-	}
-
-	ret = 0;
-	for (actual = 0; actual < len; actual += chunk_len) {
-		chunk_len = min(len - actual, page_size - byte_addr);
-
-		cmd[0] = CMD_MX25XX_PP;
-		cmd[1] = (offset >> 16) & 0xff;
-		cmd[2] = (offset >> 8) & 0xff;
-		cmd[3] = offset & 0xff;
-
-		spi_debug("PP: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x }"
-		     " chunk_len = %u\n",
-		     buf + actual, cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
-
-		ret = spi_flash_cmd(flash->spi, CMD_MX25XX_WREN, NULL, 0);
-		if (ret < 0) {
-			spi_debug("SF: Enabling Write failed\n");
-			break;
-		}
-
-		ret = spi_flash_cmd_write(flash->spi, cmd, 4,
-					  buf + actual, chunk_len);
-		if (ret < 0) {
-			spi_debug("SF: Macronix Page Program failed\n");
-			break;
-		}
-
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret)
-			break;
+	return spi_flash_cmd_erase(flash, CMD_MX25XX_SE, offset, len);
+}
 
-		offset += chunk_len;
-		byte_addr = 0;
-	}
+/*
+ * BP0-3 protect a block at the top, at least 64K or size/64, doubled for
+ * each step until it covers all of the chip. There is no TB bit in SR1.
+ */
+static void macronix_bp_range(struct spi_flash *flash, u8 sr1, u8 sr2,
+			      u32 *start, u32 *len)
+{
+	u8 bp = (sr1 >> 2) & 0xf;
+	u32 unit = flash->size >> 6;
 
-	spi_debug("SF: Macronix: Successfully programmed %u bytes @"
-	      " 0x%lx\n", len, (unsigned long)(offset - len));
+	if (unit < 0x10000)
+		unit = 0x10000;
 
-	spi_release_bus(flash->spi);
-	return ret;
-}
+	if (!bp)
+		*len = 0;
+	else if (bp > 6 || (unit << (bp - 1)) >= flash->size)
+		*len = flash->size;
+	else
+		*len = unit << (bp - 1);
 
-static int macronix_erase(struct spi_flash *flash, u32 offset, size_t len)
-{
-	return spi_flash_cmd_erase(flash, CMD_MX25XX_SE, offset, len);
+	*start = flash->size - *len;
 }
 
 static int macronix_set_lock_flags(struct spi_flash *flash, int lock)
@@ -207,7 +164,7 @@ static int macronix_set_lock_flags(struct spi_flash *flash, int lock)
 		return ret;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_MX25XX_RDSR, &status, 1);
+	ret = spi_flash_read_sr(flash, 0, &status);
 	if (ret) {
 		goto out;
 	}
@@ -228,6 +185,7 @@ static int macronix_set_lock_flags(struct spi_flash *flash, int lock)
 		goto out;
 	}
 
+	spi_flash_sr_invalidate(flash);
 	cmd = CMD_MX25XX_WRSR;
 	ret = spi_flash_cmd_write(flash->spi, &cmd, sizeof(cmd), &status, sizeof(status));
 	if (ret < 0) {
@@ -264,7 +222,7 @@ static int macronix_is_locked(struct spi_flash *flash)
 {
 	u8 status = 0;
 
-	spi_flash_cmd(flash->spi, CMD_MX25XX_RDSR, &status, 1);
+	spi_flash_read_sr(flash, 0, &status);
 
 	if ((status & (MACRONIX_SR_SRWD | MACRONIX_SR_BP3 | MACRONIX_SR_BP2 |
 		       MACRONIX_SR_BP1 | MACRONIX_SR_BP0)) ==
@@ -320,7 +278,7 @@ struct spi_flash *spi_flash_probe_macronix(struct spi_slave *spi, u8 *idcode)
 		return NULL;
 	}
 
-	mcx = malloc(sizeof(*mcx));
+	mcx = calloc(1, sizeof(*mcx));
 	if (!mcx) {
 		spi_debug("SF: Failed to allocate memory\n");
 		return NULL;
@@ -329,11 +287,17 @@ struct spi_flash *spi_flash_probe_macronix(struct spi_slave *spi, u8 *idcode)
 	mcx->params = params;
 	mcx->flash.spi = spi;
 	mcx->flash.name = params->name;
-	mcx->flash.write = macronix_write;
+	mcx->flash.write = spi_flash_cmd_write_page_program;
+	mcx->flash.page_size = params->page_size;
+	mcx->flash.program_cmd = CMD_MX25XX_PP;
 	mcx->flash.spi_erase = macronix_erase;
+	mcx->flash.erase_cmd = CMD_MX25XX_SE;
 	mcx->flash.lock = macronix_lock;
 	mcx->flash.unlock = macronix_unlock;
 	mcx->flash.is_locked = macronix_is_locked;
+	mcx->flash.bp_range = macronix_bp_range;
+	mcx->flash.bp_mask[0] = MACRONIX_SR_BP3 | MACRONIX_SR_BP2 |
+				MACRONIX_SR_BP1 | MACRONIX_SR_BP0;
 	/* The following are not yet implemented.
 	 * Implement to enable Security Registers support.
 	 */
@@ -0,0 +1,308 @@
+/*
+ * Generic driver for SPI flashes described by their SFDP tables
+ *
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+//#define SPI_DEBUG
+
+#include <stdlib.h>
+#include <string.h>
+#include <spi/spi_flash.h>
+#include <spi/spi.h>
+#include <spi/spi_flash_internal.h>
+
+#define CMD_SFDP_PP		0x02	/* Page Program */
+
+#define SFDP_SIGNATURE		0x50444653	/* "SFDP" */
+#define SFDP_HEADER_LEN		8
+#define SFDP_PARAM_HEADER_LEN	8
+#define SFDP_BFPT_ID		0xff00	/* JEDEC Basic Flash Parameter Table */
+#define SFDP_BFPT_MIN_DWORDS	9	/* JESD216 */
+#define SFDP_BFPT_TIME_DWORDS	11	/* JESD216A and later carry timings */
+#define SFDP_BFPT_MAX_DWORDS	16
+
+/* Largest chip that can be addressed with 3-byte addresses */
+#define SFDP_3B_ADDR_LIMIT	(16 * 1024 * 1024)
+
+struct sfdp_params {
+	u32 size;
+	u32 page_size;
+	u32 erase_size;
+	u8 erase_cmd;
+	u32 prog_typ_us;
+	u32 prog_max_us;
+	u32 erase_typ_us;
+	u32 erase_max_us;
+	u32 erase_max_mult;
+	/* Erase types from BFPT DWORD 8-9, size 0 when unused */
+	u32 erase_type_size[4];
+	u8 erase_type_cmd[4];
+	u32 erase_type_typ_us[4];
+};
+
+/* spi_flash needs to be first so upper layers can free() it */
+struct sfdp_spi_flash {
+	struct spi_flash flash;
+	char name[16];
+};
+
+/* Read SFDP space in chunks that fit the controller FIFO */
+static int sfdp_read(struct spi_slave *spi, u32 addr, void *buf, size_t len)
+{
+	u8 *data = buf;
+	size_t chunk;
+	u8 cmd[5];
+	int ret;
+
+	while (len) {
+		chunk = spi_crop_chunk(spi, sizeof(cmd), len);
+
+		cmd[0] = CMD_READ_SFDP;
+		cmd[1] = (addr >> 16) & 0xff;
+		cmd[2] = (addr >> 8) & 0xff;
+		cmd[3] = addr & 0xff;
+		cmd[4] = 0x00;	/* dummy byte */
+
+		ret = spi_flash_cmd_read(spi, cmd, sizeof(cmd), data, chunk);
+		if (ret)
+			return ret;
+
+		addr += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static u32 sfdp_dword(const u8 *table, unsigned int n)
+{
+	/* DWORDs are numbered from 1 in JESD216 */
+	const u8 *p = table + (n - 1) * 4;
+
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/* Typical erase time, 7-bit field: count in [4:0], unit in [6:5] */
+static u32 sfdp_erase_time_us(u32 field)
+{
+	static const u32 unit_us[] = { 1000, 16000, 128000, 1000000 };
+
+	return ((field & 0x1f) + 1) * unit_us[(field >> 5) & 0x3];
+}
+
+static int sfdp_parse(struct spi_slave *spi, struct sfdp_params *p)
+{
+	u8 header[SFDP_HEADER_LEN];
+	u8 param[SFDP_PARAM_HEADER_LEN];
+	u8 bfpt[SFDP_BFPT_MAX_DWORDS * 4];
+	unsigned int nph, i, dwords = 0;
+	u32 ptp = 0, dw, mult;
+
+	if (sfdp_read(spi, 0, header, sizeof(header)))
+		return -1;
+
+	if (sfdp_dword(header, 1) != SFDP_SIGNATURE) {
+		spi_debug("SF: No SFDP signature\n");
+		return -1;
+	}
+
+	/* Find the basic flash parameter table, NPH is zero based */
+	nph = header[6] + 1;
+	for (i = 0; i < nph; i++) {
+		if (sfdp_read(spi, SFDP_HEADER_LEN + i * SFDP_PARAM_HEADER_LEN,
+			      param, sizeof(param)))
+			return -1;
+
+		if (((param[7] << 8) | param[0]) != SFDP_BFPT_ID)
+			continue;
+
+		/* Use the latest BFPT revision the chip provides */
+		dwords = param[3];
+		ptp = param[4] | (param[5] << 8) | (param[6] << 16);
+	}
+
+	if (dwords < SFDP_BFPT_MIN_DWORDS) {
+		spi_debug("SF: SFDP basic parameter table missing\n");
+		return -1;
+	}
+
+	if (dwords > SFDP_BFPT_MAX_DWORDS)
+		dwords = SFDP_BFPT_MAX_DWORDS;
+
+	memset(bfpt, 0, sizeof(bfpt));
+	if (sfdp_read(spi, ptp, bfpt, dwords * 4))
+		return -1;
+
+	memset(p, 0, sizeof(*p));
+
+	/* DWORD 1: 4K erase opcode, addressing */
+	dw = sfdp_dword(bfpt, 1);
+	if (((dw >> 17) & 0x3) == 0x2) {
+		spi_debug("SF: SFDP part requires 4-byte addressing\n");
+		return -1;
+	}
+	if ((dw & 0x3) == 0x1) {
+		p->erase_size = 4 * 1024;
+		p->erase_cmd = (dw >> 8) & 0xff;
+	}
+	/* Without a write buffer the part is programmed byte by byte */
+	p->page_size = (dw & (1 << 2)) ? 64 : 1;
+
+	/* DWORD 2: density in bits */
+	dw = sfdp_dword(bfpt, 2);
+	if (dw & (1u << 31)) {
+		dw &= ~(1u << 31);
+		if (dw < 3 || dw > 31)
+			return -1;
+		p->size = 1u << (dw - 3);
+	} else {
+		p->size = (dw >> 3) + 1;
+	}
+
+	/* DWORD 8-9: erase types as power-of-two size and opcode */
+	for (i = 0; i < 4; i++) {
+		dw = sfdp_dword(bfpt, 8 + i / 2) >> ((i % 2) * 16);
+		if (!(dw & 0xff))
+			continue;
+		p->erase_type_size[i] = 1u << (dw & 0xff);
+		p->erase_type_cmd[i] = (dw >> 8) & 0xff;
+	}
+
+	/* Prefer the smallest erase type if there is no 4K erase */
+	if (!p->erase_size) {
+		for (i = 0; i < 4; i++) {
+			if (!p->erase_type_size[i])
+				continue;
+			if (!p->erase_size ||
+			    p->erase_type_size[i] < p->erase_size) {
+				p->erase_size = p->erase_type_size[i];
+				p->erase_cmd = p->erase_type_cmd[i];
+			}
+		}
+	}
+
+	if (!p->erase_size || !p->size) {
+		spi_debug("SF: SFDP without usable erase type\n");
+		return -1;
+	}
+
+	if (dwords < SFDP_BFPT_TIME_DWORDS)
+		return 0;
+
+	/* DWORD 10: typical erase times, max = 2 * (mult + 1) * typ */
+	dw = sfdp_dword(bfpt, 10);
+	mult = 2 * ((dw & 0xf) + 1);
+	p->erase_max_mult = mult;
+	for (i = 0; i < 4; i++) {
+		if (p->erase_type_size[i])
+			p->erase_type_typ_us[i] =
+				sfdp_erase_time_us(dw >> (4 + i * 7));
+		if (p->erase_type_size[i] == p->erase_size &&
+		    p->erase_type_cmd[i] == p->erase_cmd) {
+			p->erase_typ_us = p->erase_type_typ_us[i];
+			p->erase_max_us = p->erase_typ_us * mult;
+		}
+	}
+
+	/* DWORD 11: page size and typical page program time */
+	dw = sfdp_dword(bfpt, 11);
+	mult = 2 * ((dw & 0xf) + 1);
+	p->page_size = 1u << ((dw >> 4) & 0xf);
+	p->prog_typ_us = (((dw >> 8) & 0x1f) + 1) * ((dw & (1 << 13)) ? 64 : 8);
+	p->prog_max_us = p->prog_typ_us * mult;
+
+	return 0;
+}
+
+static int sfdp_erase(struct spi_flash *flash, u32 offset, size_t len)
+{
+	return spi_flash_cmd_erase(flash, flash->erase_cmd, offset, len);
+}
+
+struct spi_flash *spi_flash_probe_sfdp(struct spi_slave *spi, u8 *idcode)
+{
+	struct sfdp_spi_flash *sfdp;
+	struct sfdp_params params;
+
+	if (sfdp_parse(spi, &params))
+		return NULL;
+
+	/*
+	 * Only the lower 16 MiB are reachable with 3-byte addresses, taking
+	 * the part as that size would misplace the ROM window and protection
+	 */
+	if (params.size > SFDP_3B_ADDR_LIMIT) {
+		printf("SF: SFDP part %02x%02x%02x has %u MiB, only 3-byte "
+		       "addressing up to 16 MiB is supported\n", idcode[0],
+		       idcode[1], idcode[2], params.size >> 20);
+		return NULL;
+	}
+
+	sfdp = calloc(1, sizeof(*sfdp));
+	if (!sfdp) {
+		spi_debug("SF: Failed to allocate memory\n");
+		return NULL;
+	}
+
+	snprintf(sfdp->name, sizeof(sfdp->name), "SFDP %02x%02x%02x",
+		 idcode[0], idcode[1], idcode[2]);
+
+	sfdp->flash.erase_cmd = params.erase_cmd;
+	sfdp->flash.spi = spi;
+	sfdp->flash.name = sfdp->name;
+	sfdp->flash.size = params.size;
+	sfdp->flash.sector_size = params.erase_size;
+	sfdp->flash.prog_typ_us = params.prog_typ_us;
+	sfdp->flash.prog_max_us = params.prog_max_us;
+	sfdp->flash.erase_typ_us = params.erase_typ_us;
+	sfdp->flash.erase_max_us = params.erase_max_us;
+
+	sfdp->flash.write = spi_flash_cmd_write_page_program;
+	sfdp->flash.page_size = params.page_size;
+	sfdp->flash.program_cmd = CMD_SFDP_PP;
+	sfdp->flash.spi_erase = sfdp_erase;
+	sfdp->flash.read = spi_flash_cmd_read_slow;
+
+	spi_debug("SF: SFDP part, page %u, erase %u (%02x), typ %u/%u us\n",
+		  params.page_size, params.erase_size, params.erase_cmd,
+		  params.prog_typ_us, params.erase_typ_us);
+
+	return &sfdp->flash;
+}
+
+void spi_flash_sfdp_fill_timings(struct spi_flash *flash)
+{
+	struct sfdp_params params;
+	unsigned int i;
+
+	if (sfdp_parse(flash->spi, &params))
+		return;
+
+	flash->prog_typ_us = params.prog_typ_us;
+	flash->prog_max_us = params.prog_max_us;
+
+	/* Time the erase type the driver actually uses */
+	for (i = 0; i < 4; i++) {
+		if (params.erase_type_size[i] != flash->sector_size)
+			continue;
+		flash->erase_typ_us = params.erase_type_typ_us[i];
+		flash->erase_max_us = params.erase_type_typ_us[i] *
+				      params.erase_max_mult;
+		break;
+	}
+}
@@ -29,8 +29,6 @@
 #if defined (CONFIG_SB800_IMC_FWM)
 #include "SBPLATFORM.h"
 #include <vendorcode/amd/cimx/sb800/ECfan.h>
-
-static int bus_claimed = 0;
 #endif
 
 static u32 spibar;
@@ -45,6 +43,67 @@ static u32 spibar;
     #define SPI_TRACE(...)
 #endif
 
+#ifdef SPI_TRACE_RING
+//
+// Binary trace of the last transfers. Recording one costs a few stores
+// and a TSC read, so unlike SPI_TRACE it does not change the timing of
+// the flash operations being looked at.
+//
+#define SPI_TRACE_ENTRIES       256
+
+struct spi_trace_entry {
+    u64 tsc;
+    u32 addr;
+    u8 cmd;
+    u8 writecnt;
+    u8 readcnt;
+};
+
+static struct spi_trace_entry spi_trace_ring[SPI_TRACE_ENTRIES];
+static unsigned int spi_trace_head;
+
+static void spi_trace_record(u8 cmd, const u8 *data, unsigned int writecnt,
+        unsigned int readcnt)
+{
+    struct spi_trace_entry *e;
+
+    e = &spi_trace_ring[spi_trace_head++ % SPI_TRACE_ENTRIES];
+    e->tsc = timer_raw_value();
+    e->cmd = cmd;
+    e->writecnt = writecnt;
+    e->readcnt = readcnt;
+    e->addr = writecnt >= 3 ? data[0] << 16 | data[1] << 8 | data[2] : 0;
+}
+
+void spi_trace_dump(void)
+{
+    unsigned int i, count, first;
+    struct spi_trace_entry *e;
+    u64 prev, mhz;
+
+    count = spi_trace_head < SPI_TRACE_ENTRIES ? spi_trace_head
+                                               : SPI_TRACE_ENTRIES;
+    first = spi_trace_head - count;
+    mhz = timer_hz() / 1000000;
+    if (!mhz)
+        mhz = 1;
+
+    printf("SPI trace, %u of %u transfers\n", count, spi_trace_head);
+    printf("  op  addr    out  in     +us\n");
+
+    prev = count ? spi_trace_ring[first % SPI_TRACE_ENTRIES].tsc : 0;
+    for (i = first; i != spi_trace_head; i++) {
+        e = &spi_trace_ring[i % SPI_TRACE_ENTRIES];
+        printf("  %02x  %06x  %3u  %2u  %6llu\n", e->cmd, e->addr,
+               e->writecnt, e->readcnt,
+               (unsigned long long)((e->tsc - prev) / mhz));
+        prev = e->tsc;
+    }
+}
+#else
+#define spi_trace_record(cmd, data, writecnt, readcnt)
+#endif
+
 #ifdef FCH_YANGTZEE
 
 //
@@ -72,6 +131,133 @@ static u32 spibar;
 
 #define FIFO_SIZE_YANGTZE 71
 
+//
+// SPI_Cntrl0 SpiReadMode[2:1] in bits 30:29 and SpiReadMode[0] in bit 18,
+// used for memory mapped reads
+//
+#define SPI_CNTRL0              0x00
+#define SPI_READ_MODE_MASK      ((3 << 29) | (1 << 18))
+#define SPI_READ_MODE_FAST      ((3 << 29) | (1 << 18))
+
+//
+// SPI100 registers
+// SPIx20 Spi100Enable[0]: UseSpi100
+// SPIx22 Spi100SpeedConfig: NormSpeed[15:12] (normal read and commands),
+//        FastSpeed[11:8] (fast read), AltSpeed[7:4], TpmSpeed[3:0]
+//
+#define SPI100_ENABLE           0x20
+#define SPI100_USE_SPI100       (1 << 0)
+#define SPI100_SPEED_CONFIG     0x22
+#define SPI100_NORM_SPEED_SHIFT 12
+#define SPI100_FAST_SPEED_SHIFT 8
+#define SPI100_SPEED_MASK       0xf
+
+// Normal read (0x03) is only specified up to 33 MHz
+#define SPI_NORM_READ_MAX_HZ    33000000
+
+static const struct {
+    unsigned int hz;
+    u8 code;
+} spi100_speeds[] = {
+    { 66000000, 0 },
+    { 33000000, 1 },
+    { 22000000, 2 },
+    { 16500000, 3 },
+    {   800000, 5 },
+};
+
+static u16 saved_speed_config;
+static u32 saved_cntrl0;
+static int speed_applied;
+
+static u8 spi100_speed_code(unsigned int hz)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(spi100_speeds) - 1; i++)
+        if (spi100_speeds[i].hz <= hz)
+            break;
+
+    return spi100_speeds[i].code;
+}
+
+//
+// Program the controller for the slave speed, the current settings must
+// have been saved before
+//
+static void spi100_apply_speed(const struct spi_slave *slave)
+{
+    unsigned int norm_hz = slave->max_hz;
+    u16 speed;
+    u32 cntrl0;
+
+    if (!slave->max_hz)
+        return;
+
+    if (!(readb(spibar + SPI100_ENABLE) & SPI100_USE_SPI100)) {
+        SPI_TRACE("SPI100 disabled, keeping legacy speed settings\n");
+        return;
+    }
+
+    if (norm_hz > SPI_NORM_READ_MAX_HZ)
+        norm_hz = SPI_NORM_READ_MAX_HZ;
+
+    speed = saved_speed_config;
+    speed &= ~((SPI100_SPEED_MASK << SPI100_NORM_SPEED_SHIFT) |
+               (SPI100_SPEED_MASK << SPI100_FAST_SPEED_SHIFT));
+    speed |= spi100_speed_code(norm_hz) << SPI100_NORM_SPEED_SHIFT;
+    speed |= spi100_speed_code(slave->max_hz) << SPI100_FAST_SPEED_SHIFT;
+    writew(speed, spibar + SPI100_SPEED_CONFIG);
+
+    //
+    // Above 33 MHz memory mapped reads have to use fast read, below it any
+    // read mode firmware picked works
+    //
+    cntrl0 = saved_cntrl0;
+    if (slave->max_hz > SPI_NORM_READ_MAX_HZ) {
+        cntrl0 &= ~SPI_READ_MODE_MASK;
+        cntrl0 |= SPI_READ_MODE_FAST;
+    }
+    writel(cntrl0, spibar + SPI_CNTRL0);
+    speed_applied = 1;
+
+    SPI_TRACE("%s: speed config %04x, cntrl0 %08x\n", __func__, speed, cntrl0);
+}
+
+static void spi100_claim_speed(const struct spi_slave *slave)
+{
+    saved_speed_config = readw(spibar + SPI100_SPEED_CONFIG);
+    saved_cntrl0 = readl(spibar + SPI_CNTRL0);
+    spi100_apply_speed(slave);
+}
+
+static void spi100_restore_speed(void)
+{
+    if (!speed_applied)
+        return;
+
+    writew(saved_speed_config, spibar + SPI100_SPEED_CONFIG);
+    writel(saved_cntrl0, spibar + SPI_CNTRL0);
+    speed_applied = 0;
+}
+
+static void spi100_release_speed(const struct spi_slave *slave)
+{
+    spi100_restore_speed();
+}
+
+void spi_set_speed(struct spi_slave *slave, uint32_t hz)
+{
+    slave->max_hz = hz;
+
+    if (!slave->claim_depth)
+        return;
+
+    // Bus already claimed, switch to the new speed right away
+    spi100_restore_speed();
+    spi100_apply_speed(slave);
+}
+
 static void execute_command(void)
 {
     SPI_TRACE("execute_command\n");
@@ -126,6 +312,7 @@ int spi_xfer(struct spi_slave *slave,
     writeCnt--;
 
     SPI_TRACE("%s, cmd=0x%02x, writecnt=%d, readcnt=%d\n", __func__, cmd, writeCnt, readCnt);
+    spi_trace_record(cmd, writeBuff, writeCnt, readCnt);
     writeb(cmd, spibar + 0);
 
     int ret = check_readwritecnt(writeCnt, readCnt);
@@ -166,6 +353,21 @@ int spi_xfer(struct spi_slave *slave,
     return 0;
 }
 
+unsigned int spi_crop_chunk(const struct spi_slave *slave, unsigned int cmd_len,
+        unsigned int buf_len)
+{
+    //
+    // The opcode goes to SPI_Cntrl0, the rest of the command shares
+    // the FIFO with the data
+    //
+    unsigned int room = FIFO_SIZE_YANGTZE - (cmd_len - 1);
+
+    if (room > FIFO_SIZE_YANGTZE - 3)
+        room = FIFO_SIZE_YANGTZE - 3;
+
+    return buf_len < room ? buf_len : room;
+}
+
 //
 // Support for previous generations of spi controllers
 //
@@ -201,6 +403,8 @@ int spi_xfer(struct spi_slave *slave, const void *dout,
 	bytesout = bitsout / 8;
 	bytesin  = bitsin / 8;
 
+	spi_trace_record(cmd, dout, bytesout, bytesin);
+
 	readoffby1 = bytesout ? 0 : 1;
 
 	readwrite = (bytesin + readoffby1) << 4 | bytesout;
@@ -228,6 +432,29 @@ int spi_xfer(struct spi_slave *slave, const void *dout,
 
 	return 0;
 }
+
+unsigned int spi_crop_chunk(const struct spi_slave *slave, unsigned int cmd_len,
+		unsigned int buf_len)
+{
+	/* Command bytes past the opcode and the data share the FIFO */
+	unsigned int room = FIFO_SIZE_OLD - (cmd_len - 1);
+
+	return buf_len < room ? buf_len : room;
+}
+
+/* Only the SPI100 controller speed is handled, keep what firmware set */
+static void spi100_claim_speed(const struct spi_slave *slave)
+{
+}
+
+static void spi100_release_speed(const struct spi_slave *slave)
+{
+}
+
+void spi_set_speed(struct spi_slave *slave, uint32_t hz)
+{
+	slave->max_hz = hz;
+}
 #endif
 
 void spi_init(void)
@@ -236,6 +463,28 @@ void spi_init(void)
     spibar = pci_read_config32(dev, 0xA0) & ~0x1F;
 }
 
+//
+// LPC ISA bridge D14F3xBB[0] PrefetchEnSPIFromHost, dropping it empties the
+// buffer the FCH keeps of host reads from the ROM
+//
+#define LPC_MISC_CONTROL_BITS   0xbb
+#define LPC_PREFETCH_EN_SPI     (1 << 0)
+
+void spi_mmap_invalidate(void)
+{
+	pcidev_t dev = PCI_DEV(0, 0x14, 3);
+	u8 reg = pci_read_config8(dev, LPC_MISC_CONTROL_BITS);
+
+	if (reg & LPC_PREFETCH_EN_SPI) {
+		pci_write_config8(dev, LPC_MISC_CONTROL_BITS,
+				  reg & ~LPC_PREFETCH_EN_SPI);
+		pci_write_config8(dev, LPC_MISC_CONTROL_BITS, reg);
+	}
+
+	/* Firmware maps the ROM cacheable */
+	asm volatile ("wbinvd" ::: "memory");
+}
+
 #if defined (CONFIG_SB800_IMC_FWM)
 
 static void ImcSleep(void)
@@ -268,30 +517,38 @@ static void ImcWakeup(void)
 
 int spi_claim_bus(struct spi_slave *slave)
 {
+	/* Only the outermost claim touches the hardware */
+	if (!slave->claim_depth++)
+		spi100_claim_speed(slave);
+
+	/*
+	 * The first write claim keeps the IMC away from the flash until the
+	 * claim it is nested in is released, further ones just count.
+	 */
+	if (slave->rw == SPI_WRITE_FLAG && !slave->write_depth) {
+		slave->write_depth = slave->claim_depth;
 #if defined (CONFIG_SB800_IMC_FWM)
-
-	if (slave->rw == SPI_WRITE_FLAG) {
-		bus_claimed++;
-		if (bus_claimed == 1)
-			ImcSleep();
-	}
+		ImcSleep();
 #endif
+	}
 
 	return 0;
 }
 
 void spi_release_bus(struct spi_slave *slave)
 {
-#if defined (CONFIG_SB800_IMC_FWM)
+	if (!slave->claim_depth)
+		return;
 
-	if (slave->rw == SPI_WRITE_FLAG)  {
-		bus_claimed--;
-		if (bus_claimed <= 0) {
-			bus_claimed = 0;
-			ImcWakeup();
-		}
-	}
+	if (slave->write_depth == slave->claim_depth) {
+		slave->write_depth = 0;
+#if defined (CONFIG_SB800_IMC_FWM)
+		ImcWakeup();
 #endif
+	}
+
+	if (!--slave->claim_depth)
+		spi100_release_speed(slave);
 }
 
 void spi_cs_activate(struct spi_slave *slave)
@@ -312,6 +569,10 @@ struct spi_slave *spi_setup_slave(unsigned int bus, unsigned int cs,
 	}
 
 	memset(slave, 0, sizeof(*slave));
+	slave->bus = bus;
+	slave->cs = cs;
+	slave->max_hz = max_hz;
+	slave->mode = mode;
 
 	return slave;
 }
@@ -102,6 +102,79 @@ int spi_flash_cmd_read_slow(struct spi_flash *flash, u32 offset,
 	return spi_flash_cmd_read(spi, cmd, sizeof(cmd), data, len);
 }
 
+/*
+ * Firmware decodes the top 16 MiB below 4 GiB to the SPI ROM. The FCH decode
+ * registers are not read back, a chip up to this size is taken as mapped
+ * in full, as coreboot's x86 boot media code does too.
+ */
+#define SPI_FLASH_MMAP_MAX	(16 * 1024 * 1024)
+
+static void spi_flash_mmap_copy(void *buf, uintptr_t src, size_t len)
+{
+	u8 *dst = buf;
+
+	/* Word copy when source and destination can both be aligned */
+	if (!((src ^ (uintptr_t)dst) & 3)) {
+		for (; len && (src & 3); len--)
+			*dst++ = readb(src++);
+		for (; len >= 4; len -= 4, src += 4, dst += 4)
+			*(u32 *)dst = readl(src);
+	}
+
+	while (len--)
+		*dst++ = readb(src++);
+}
+
+static int spi_flash_read_fifo(struct spi_flash *flash, u32 offset,
+			       size_t len, void *buf)
+{
+	struct spi_slave *spi = flash->spi;
+	size_t chunk;
+	int ret = 0;
+
+	spi->rw = SPI_READ_FLAG;
+	spi_claim_bus(spi);
+
+	while (len) {
+		/* Fast read is the longest read command: opcode, address, dummy */
+		chunk = spi_crop_chunk(spi, 5, len);
+		ret = flash->read(flash, offset, chunk, buf);
+		if (ret)
+			break;
+
+		offset += chunk;
+		buf += chunk;
+		len -= chunk;
+	}
+
+	spi_release_bus(spi);
+	return ret;
+}
+
+int spi_flash_read(struct spi_flash *flash, u32 offset, size_t len, void *buf)
+{
+	u32 size = flash->size;
+	u32 start;
+
+	if (!size || size > SPI_FLASH_MMAP_MAX || (size & (size - 1)))
+		return spi_flash_read_fifo(flash, offset, len, buf);
+
+	/* Callers may pass the CPU address of the data */
+	start = offset & (size - 1);
+	if (len > size - start)
+		return spi_flash_read_fifo(flash, offset, len, buf);
+
+	if (flash->mmap_stale) {
+		spi_mmap_invalidate();
+		flash->mmap_stale = 0;
+	}
+
+	spi_flash_mmap_copy(buf, (uintptr_t)(0x100000000ULL - size) + start,
+			    len);
+
+	return 0;
+}
+
 int spi_flash_cmd_poll_bit(struct spi_flash *flash, unsigned long timeout,
 			   u8 cmd, u8 poll_bit)
 {
@@ -136,6 +209,307 @@ int spi_flash_cmd_wait_ready(struct spi_flash *flash, unsigned long timeout)
 		CMD_READ_STATUS, STATUS_WIP);
 }
 
+int spi_flash_cmd_wait_ready_timed(struct spi_flash *flash, u32 typ_us,
+				   u32 max_us, unsigned long timeout)
+{
+	if (typ_us)
+		udelay(typ_us);
+
+	/*
+	 * The timeout is in ms, 500 polls of at least 2 us each. Allow twice
+	 * the maximum time, but never less than the driver's default in case
+	 * the part's SFDP table is optimistic.
+	 */
+	if (max_us)
+		timeout = MAX(timeout, max_us / 500 + 1);
+
+	return spi_flash_cmd_wait_ready(flash, timeout);
+}
+
+int spi_flash_start_program(struct spi_flash *flash, u32 offset, size_t len,
+			    const void *buf)
+{
+	unsigned long page_size;
+	size_t chunk_len;
+	int ret;
+	u8 cmd[4];
+
+	page_size = min(flash->page_size, CONTROLLER_PAGE_LIMIT);
+	chunk_len = min(len, page_size - offset % page_size);
+	chunk_len = spi_crop_chunk(flash->spi, sizeof(cmd), chunk_len);
+
+	cmd[0] = flash->program_cmd;
+	spi_flash_addr(offset, cmd);
+
+	ret = spi_flash_cmd(flash->spi, CMD_WRITE_ENABLE, NULL, 0);
+	if (ret) {
+		spi_debug("SF: Enabling Write failed\n");
+		return -1;
+	}
+
+	flash->mmap_stale = 1;
+	ret = spi_flash_cmd_write(flash->spi, cmd, sizeof(cmd), buf, chunk_len);
+	if (ret) {
+		spi_debug("SF: Page Program failed\n");
+		return -1;
+	}
+
+	return chunk_len;
+}
+
+int spi_flash_start_erase(struct spi_flash *flash, u32 offset)
+{
+	int ret;
+	u8 cmd[4];
+
+	cmd[0] = flash->erase_cmd;
+	spi_flash_addr(offset, cmd);
+
+	ret = spi_flash_cmd(flash->spi, CMD_WRITE_ENABLE, NULL, 0);
+	if (ret)
+		return ret;
+
+	flash->mmap_stale = 1;
+	return spi_flash_cmd_write(flash->spi, cmd, sizeof(cmd), NULL, 0);
+}
+
+int spi_flash_is_busy(struct spi_flash *flash)
+{
+	u8 cmd = CMD_READ_STATUS;
+	u8 status;
+
+	if (spi_flash_cmd_read(flash->spi, &cmd, 1, &status, 1))
+		return -1;
+
+	return !!(status & STATUS_WIP);
+}
+
+static const u8 spi_flash_rdsr_cmd[] = {
+	CMD_READ_STATUS, CMD_READ_STATUS2, CMD_READ_STATUS3
+};
+
+int spi_flash_read_sr(struct spi_flash *flash, unsigned int reg, u8 *value)
+{
+	u8 status;
+
+	if (reg >= ARRAY_SIZE(spi_flash_rdsr_cmd))
+		return -1;
+
+	if (!(flash->sr_valid & (1 << reg))) {
+		if (spi_flash_cmd(flash->spi, spi_flash_rdsr_cmd[reg],
+				  &status, 1))
+			return -1;
+
+		if (reg == 0)
+			status &= ~(STATUS_WIP | STATUS_WEL);
+
+		flash->sr[reg] = status;
+		flash->sr_valid |= 1 << reg;
+	}
+
+	*value = flash->sr[reg];
+	return 0;
+}
+
+int spi_flash_write_sr(struct spi_flash *flash, const u8 *sr, size_t len,
+		       int temporary)
+{
+	int ret;
+	u8 cmd;
+
+	flash->spi->rw = SPI_WRITE_FLAG;
+	ret = spi_claim_bus(flash->spi);
+	if (ret) {
+		spi_debug("SF: Unable to claim SPI bus\n");
+		return ret;
+	}
+
+	flash->sr_valid = 0;
+
+	ret = spi_flash_cmd(flash->spi, temporary ?
+			    CMD_VOLATILE_SR_WRITE_ENABLE : CMD_WRITE_ENABLE,
+			    NULL, 0);
+	if (ret) {
+		spi_debug("SF: Enabling Write failed\n");
+		goto out;
+	}
+
+	cmd = CMD_WRITE_STATUS;
+	ret = spi_flash_cmd_write(flash->spi, &cmd, sizeof(cmd), sr, len);
+	if (ret) {
+		spi_debug("SF: Status register write failed\n");
+		goto out;
+	}
+
+	/* Non-volatile write takes up to 15ms, volatile one is done at once */
+	ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+
+out:
+	spi_release_bus(flash->spi);
+	return ret;
+}
+
+/* Status register bits used for block protection, SR1 in the low byte */
+static u16 spi_flash_bp_mask(const struct spi_flash *flash)
+{
+	return flash->bp_mask[1] << 8 | flash->bp_mask[0];
+}
+
+/* Pack the block protect bits of SR1 and SR2 into a bp_row index */
+static unsigned int spi_flash_bp_key(const struct spi_flash *flash,
+				     u8 sr1, u8 sr2)
+{
+	u16 mask = spi_flash_bp_mask(flash);
+	u16 bits = sr2 << 8 | sr1;
+	unsigned int key = 0, n = 0;
+	u16 bit;
+
+	for (bit = 1; bit; bit <<= 1) {
+		if (!(mask & bit))
+			continue;
+		if (bits & bit)
+			key |= 1 << n;
+		n++;
+	}
+
+	return key;
+}
+
+static void spi_flash_bp_bits(const struct spi_flash *flash,
+			      unsigned int key, u8 *sr1, u8 *sr2)
+{
+	u16 mask = spi_flash_bp_mask(flash);
+	u16 bits = 0;
+	u16 bit;
+
+	for (bit = 1; bit; bit <<= 1) {
+		if (!(mask & bit))
+			continue;
+		if (key & 1)
+			bits |= bit;
+		key >>= 1;
+	}
+
+	*sr1 = bits;
+	*sr2 = bits >> 8;
+}
+
+static int spi_flash_bp_init(struct spi_flash *flash)
+{
+	unsigned int keys = 1, key, row;
+	struct spi_flash_bp bp;
+	u16 mask;
+
+	for (mask = spi_flash_bp_mask(flash); mask; mask &= mask - 1)
+		keys <<= 1;
+
+	flash->bp_table = malloc(keys * sizeof(*flash->bp_table));
+	flash->bp_row = malloc(keys);
+	if (!flash->bp_table || !flash->bp_row) {
+		free(flash->bp_table);
+		free(flash->bp_row);
+		flash->bp_table = NULL;
+		flash->bp_row = NULL;
+		return -1;
+	}
+
+	/* SR2 bits are the top of the key, settings without them come first */
+	flash->bp_count = 0;
+	for (key = 0; key < keys; key++) {
+		spi_flash_bp_bits(flash, key, &bp.sr1, &bp.sr2);
+		flash->bp_range(flash, bp.sr1, bp.sr2, &bp.start, &bp.len);
+		if (!bp.len)
+			bp.start = 0;
+
+		for (row = 0; row < flash->bp_count; row++)
+			if (flash->bp_table[row].start == bp.start &&
+			    flash->bp_table[row].len == bp.len)
+				break;
+
+		if (row == flash->bp_count)
+			flash->bp_table[flash->bp_count++] = bp;
+		flash->bp_row[key] = row;
+	}
+
+	return 0;
+}
+
+const struct spi_flash_bp *spi_flash_bp_lookup(struct spi_flash *flash,
+					       u8 sr1, u8 sr2)
+{
+	if (!flash->bp_table)
+		return NULL;
+
+	return &flash->bp_table[flash->bp_row[spi_flash_bp_key(flash, sr1,
+								 sr2)]];
+}
+
+void spi_flash_bp_range_w25q(struct spi_flash *flash, u8 sr1, u8 sr2,
+			     u32 *start, u32 *len)
+{
+	u8 bp = (sr1 >> 2) & 7;
+	int top = !(sr1 & (1 << 5));	/* TB */
+	u32 block;
+
+	if (!bp)
+		block = 0;
+	else if (bp == 7)
+		block = flash->size;
+	else if (sr1 & (1 << 6))	/* SEC */
+		block = 0x1000 << min(bp - 1, 3);
+	else
+		block = (flash->size >> 6) << (bp - 1);
+
+	if (sr2 & (1 << 6)) {		/* CMP */
+		block = flash->size - block;
+		top = !top;
+	}
+
+	*start = top ? flash->size - block : 0;
+	*len = block;
+}
+
+int spi_flash_cmd_write_page_program(struct spi_flash *flash, u32 offset,
+				     size_t len, const void *buf)
+{
+	size_t actual;
+	u32 typ_us;
+	int ret, chunk_len;
+
+	flash->spi->rw = SPI_WRITE_FLAG;
+	ret = spi_claim_bus(flash->spi);
+	if (ret) {
+		spi_debug("SF: Unable to claim SPI bus\n");
+		return ret;
+	}
+
+	for (actual = 0; actual < len; actual += chunk_len) {
+		chunk_len = spi_flash_start_program(flash, offset,
+						    len - actual, buf + actual);
+		if (chunk_len < 0) {
+			ret = chunk_len;
+			goto out;
+		}
+
+		/* Program time scales with the part of the page written */
+		typ_us = flash->prog_typ_us * chunk_len / flash->page_size;
+		ret = spi_flash_cmd_wait_ready_timed(flash, typ_us,
+						     flash->prog_max_us,
+						     SPI_FLASH_PROG_TIMEOUT);
+		if (ret)
+			goto out;
+
+		offset += chunk_len;
+	}
+
+	spi_debug("SF: %s: Successfully programmed %u bytes @ 0x%lx\n",
+		  flash->name, len, (unsigned long)(offset - len));
+
+out:
+	spi_release_bus(flash->spi);
+	return ret;
+}
+
 int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 			u32 offset, size_t len)
 {
@@ -175,7 +549,9 @@ int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 		if (ret)
 			goto out;
 
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PAGE_ERASE_TIMEOUT);
+		ret = spi_flash_cmd_wait_ready_timed(flash, flash->erase_typ_us,
+						     flash->erase_max_us,
+						     SPI_FLASH_PAGE_ERASE_TIMEOUT);
 		if (ret)
 			goto out;
 	}
@@ -216,17 +592,35 @@ static struct {
 	const u8 idcode;
 	struct spi_flash *(*probe) (struct spi_slave *spi, u8 *idcode);
 } flashes[] = {
-	/* Keep it sorted by define name */
+	/* Keep it sorted by define name, SPI_SKIP_VENDORS drops entries */
+#ifndef SPI_FLASH_NO_ADESTO
 	{ 0, 0x1f, spi_flash_probe_adesto, },
+#endif
+#ifndef SPI_FLASH_NO_EON
 	{ 0, 0x1c, spi_flash_probe_eon, },
+#endif
+#ifndef SPI_FLASH_NO_GIGADEVICE
 	{ 0, 0xc8, spi_flash_probe_gigadevice, },
+#endif
+#ifndef SPI_FLASH_NO_MACRONIX
 	{ 0, 0xc2, spi_flash_probe_macronix, },
+#endif
+#ifndef SPI_FLASH_NO_SPANSION
 	{ 0, 0x01, spi_flash_probe_spansion, },
+#endif
+#ifndef SPI_FLASH_NO_SST
 	{ 0, 0xbf, spi_flash_probe_sst, },
+#endif
+#ifndef SPI_FLASH_NO_STMICRO
 	{ 0, 0x20, spi_flash_probe_stmicro, },
+#endif
+#ifndef SPI_FLASH_NO_WINBOND
 	{ 0, 0xef, spi_flash_probe_winbond, },
+#endif
 	/* Keep it sorted by best detection */
+#ifndef SPI_FLASH_NO_STMICRO
 	{ 0, 0xff, spi_flash_probe_stmicro, },
+#endif
 };
 #define IDCODE_LEN (IDCODE_CONT_LEN + IDCODE_PART_LEN)
 
@@ -276,6 +670,18 @@ struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 				break;
 		}
 
+	if (flash) {
+		/* Known part, SFDP only refines the operation times */
+		flash->prog_typ_us = 0;
+		flash->prog_max_us = 0;
+		flash->erase_typ_us = 0;
+		flash->erase_max_us = 0;
+		spi_flash_sfdp_fill_timings(flash);
+	} else {
+		/* Unknown part, describe it from its own SFDP tables */
+		flash = spi_flash_probe_sfdp(spi, idcode);
+	}
+
 	if (!flash) {
 		spi_debug("SF: Unsupported manufacturer %02x\n", *idp);
 		goto err_manufacturer_probe;
@@ -284,6 +690,9 @@ struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 	spi_debug("SF: Detected %s with page size %x, total %x\n",
 			flash->name, flash->sector_size, flash->size);
 
+	if (flash->bp_range && spi_flash_bp_init(flash))
+		spi_debug("SF: No memory for the block protection table\n");
+
 	spi_release_bus(spi);
 
 	return flash;
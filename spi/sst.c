@@ -39,9 +39,15 @@
 #define SST_SR_AAI   (1 << 6)	/* Addressing mode */
 #define SST_SR_BPL   (1 << 7)	/* BP bits lock */
 
+/* Part has a 256 byte page program instead of AAI word program */
+#define SST_FEAT_PP  (1 << 0)
+#define SST_PAGE_SIZE 256
+
 struct sst_spi_flash_params {
 	u8 idcode1;
 	u16 nr_sectors;
+	u8 flags;
+	u8 tbp_us;	/* maximum byte / AAI word program time */
 	const char *name;
 };
 
@@ -60,38 +66,48 @@ static const struct sst_spi_flash_params sst_spi_flash_table[] = {
 	{
 		.idcode1 = 0x8d,
 		.nr_sectors = 128,
+		.tbp_us = 10,
 		.name = "SST25VF040B",
 	},{
 		.idcode1 = 0x8e,
 		.nr_sectors = 256,
+		.tbp_us = 10,
 		.name = "SST25VF080B",
 	},{
 		.idcode1 = 0x41,
 		.nr_sectors = 512,
+		.tbp_us = 10,
 		.name = "SST25VF016B",
 	},{
 		.idcode1 = 0x4a,
 		.nr_sectors = 1024,
+		.tbp_us = 10,
 		.name = "SST25VF032B",
 	},{
 		.idcode1 = 0x4b,
 		.nr_sectors = 2048,
+		.flags = SST_FEAT_PP,
+		.tbp_us = 10,
 		.name = "SST25VF064C",
 	},{
 		.idcode1 = 0x01,
 		.nr_sectors = 16,
+		.tbp_us = 50,
 		.name = "SST25WF512",
 	},{
 		.idcode1 = 0x02,
 		.nr_sectors = 32,
+		.tbp_us = 50,
 		.name = "SST25WF010",
 	},{
 		.idcode1 = 0x03,
 		.nr_sectors = 64,
+		.tbp_us = 50,
 		.name = "SST25WF020",
 	},{
 		.idcode1 = 0x04,
 		.nr_sectors = 128,
+		.tbp_us = 50,
 		.name = "SST25WF040",
 	},
 };
@@ -126,6 +142,7 @@ sst_disable_writing(struct spi_flash *flash)
 static int
 sst_byte_write(struct spi_flash *flash, u32 offset, const void *buf)
 {
+	struct sst_spi_flash *sst = to_sst_spi_flash(flash);
 	int ret;
 	u8 cmd[4] = {
 		CMD_SST_BP,
@@ -134,8 +151,8 @@ sst_byte_write(struct spi_flash *flash, u32 offset, const void *buf)
 		offset,
 	};
 
-	spi_debug("BP[%02x]: 0x%p => cmd = { 0x%02x 0x%06x }\n",
-		spi_w8r8(flash->spi, CMD_SST_RDSR), buf, cmd[0], offset);
+	spi_debug("BP: 0x%p => cmd = { 0x%02x 0x%06x }\n",
+		buf, cmd[0], offset);
 
 	ret = sst_enable_writing(flash);
 	if (ret)
@@ -145,12 +162,14 @@ sst_byte_write(struct spi_flash *flash, u32 offset, const void *buf)
 	if (ret)
 		return ret;
 
-	return spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+	return spi_flash_cmd_wait_ready_timed(flash, sst->params->tbp_us, 0,
+					      SPI_FLASH_PROG_TIMEOUT);
 }
 
 static int
 sst_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
 {
+	struct sst_spi_flash *sst = to_sst_spi_flash(flash);
 	size_t actual, cmd_len;
 	int ret;
 	u8 cmd[4];
@@ -181,10 +200,14 @@ sst_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
 	cmd[2] = offset >> 8;
 	cmd[3] = offset;
 
-	for (; actual < len - 1; actual += 2) {
-		spi_debug("WP[%02x]: 0x%p => cmd = { 0x%02x 0x%06x }\n",
-		     spi_w8r8(flash->spi, CMD_SST_RDSR), buf + actual, cmd[0],
-		     offset);
+	/*
+	 * A word is done after at most TBP, so just wait that long between
+	 * words instead of polling the status register after each one. The
+	 * status is only checked once, when the AAI run is over.
+	 */
+	for (; actual + 1 < len; actual += 2) {
+		spi_debug("WP: 0x%p => cmd = { 0x%02x 0x%06x }\n",
+		     buf + actual, cmd[0], offset);
 
 		ret = spi_flash_cmd_write(flash->spi, cmd, cmd_len,
 		                          buf + actual, 2);
@@ -193,14 +216,16 @@ sst_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
 			break;
 		}
 
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret)
-			break;
+		udelay(sst->params->tbp_us);
 
 		cmd_len = 1;
 		offset += 2;
 	}
 
+	/* Leave AAI mode only once the last word has completed */
+	if (!ret && cmd_len == 1)
+		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+
 	if (!ret)
 		ret = sst_disable_writing(flash);
 
@@ -232,14 +257,13 @@ sst_unlock(struct spi_flash *flash)
 	if (ret)
 		return ret;
 
+	spi_flash_sr_invalidate(flash);
 	cmd = CMD_SST_WRSR;
 	status = 0;
 	ret = spi_flash_cmd_write(flash->spi, &cmd, 1, &status, 1);
 	if (ret)
 		spi_debug("SF: Unable to set status byte\n");
 
-	spi_debug("SF: SST: status = %x\n", spi_w8r8(flash->spi, CMD_SST_RDSR));
-
 	return ret;
 }
 
@@ -261,7 +285,7 @@ spi_flash_probe_sst(struct spi_slave *spi, u8 *idcode)
 		return NULL;
 	}
 
-	stm = malloc(sizeof(*stm));
+	stm = calloc(1, sizeof(*stm));
 	if (!stm) {
 		spi_debug("SF: Failed to allocate memory\n");
 		return NULL;
@@ -271,8 +295,15 @@ spi_flash_probe_sst(struct spi_slave *spi, u8 *idcode)
 	stm->flash.spi = spi;
 	stm->flash.name = params->name;
 
-	stm->flash.write = sst_write;
+	if (params->flags & SST_FEAT_PP) {
+		stm->flash.write = spi_flash_cmd_write_page_program;
+		stm->flash.page_size = SST_PAGE_SIZE;
+		stm->flash.program_cmd = CMD_SST_BP;
+	} else {
+		stm->flash.write = sst_write;
+	}
 	stm->flash.spi_erase = sst_erase;
+	stm->flash.erase_cmd = CMD_SST_SE;
 	stm->flash.read = spi_flash_cmd_read_fast;
 	stm->flash.sector_size = SST_SECTOR_SIZE;
 	stm->flash.size = stm->flash.sector_size * params->nr_sectors;
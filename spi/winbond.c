@@ -31,12 +31,6 @@ struct winbond_spi_flash {
 	const struct winbond_spi_flash_params *params;
 };
 
-static inline struct winbond_spi_flash *
-to_winbond_spi_flash(struct spi_flash *flash)
-{
-	return container_of(flash, struct winbond_spi_flash, flash);
-}
-
 static const struct winbond_spi_flash_params winbond_spi_flash_table[] = {
 	{
 		.id			= 0x3015,
@@ -96,79 +90,63 @@ static const struct winbond_spi_flash_params winbond_spi_flash_table[] = {
 	},
 };
 
-static int winbond_write(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
+static int winbond_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	struct winbond_spi_flash *stm = to_winbond_spi_flash(flash);
-	unsigned long byte_addr;
-	unsigned long page_size;
-	size_t chunk_len;
-	size_t actual;
-	int ret;
-	u8 cmd[4];
-
-	page_size = min(1 << stm->params->l2_page_size, CONTROLLER_PAGE_LIMIT);
-	byte_addr = offset % page_size;
+	return spi_flash_cmd_erase(flash, CMD_W25_SE, offset, len);
+}
 
-	flash->spi->rw = SPI_WRITE_FLAG;
-	ret = spi_claim_bus(flash->spi);
-	if (ret) {
-		spi_debug("SF: Unable to claim SPI bus\n");
-		return ret;
-	}
+#define REG_W25_BP_MASK	(REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0)
+#define REG_W25_LOCK_MASK	(REG_W25_SRP0 | REG_W25_SEC | REG_W25_TB | \
+				 REG_W25_BP_MASK)
 
-	for (actual = 0; actual < len; actual += chunk_len) {
-		chunk_len = min(len - actual, page_size - byte_addr);
+/* W25X parts have no SR2, hence no CMP, and no volatile status register */
+static int winbond_is_w25q(struct spi_flash *flash)
+{
+	struct winbond_spi_flash *stm = (struct winbond_spi_flash *)flash;
 
-		cmd[0] = CMD_W25_PP;
-		cmd[1] = (offset >> 16) & 0xff;
-		cmd[2] = (offset >> 8) & 0xff;
-		cmd[3] = offset & 0xff;
+	return (stm->params->id >> 8) != 0x30;
+}
 
-		spi_debug("PP: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x }"
-		        " chunk_len = %u\n", buf + actual,
-			cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
+/*
+ * SR1 and SR2 protection bits lock() writes: the layout protecting the most
+ * while leaving wp_keep_offset/len writable, everything if there is none.
+ */
+static void winbond_lock_bits(struct spi_flash *flash, u8 *sr1, u8 *sr2)
+{
+	u32 keep_end = flash->wp_keep_offset + flash->wp_keep_len;
+	const struct spi_flash_bp *bp;
+	u32 best = 0;
+	unsigned int i;
 
-		ret = spi_flash_cmd(flash->spi, CMD_W25_WREN, NULL, 0);
-		if (ret < 0) {
-			spi_debug("SF: Enabling Write failed\n");
-			goto out;
-		}
+	*sr1 = REG_W25_SRP0 | REG_W25_BP_MASK;
+	*sr2 = 0;
 
-		ret = spi_flash_cmd_write(flash->spi, cmd, 4,
-				buf + actual, chunk_len);
-		if (ret < 0) {
-			spi_debug("SF: Winbond Page Program failed\n");
-			goto out;
-		}
+	if (!flash->wp_keep_len || !winbond_is_w25q(flash))
+		return;
 
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret)
-			goto out;
+	for (i = 0; flash->bp_table && i < flash->bp_count; i++) {
+		bp = &flash->bp_table[i];
+		if (bp->len <= best || (bp->start < keep_end &&
+		    flash->wp_keep_offset < bp->start + bp->len))
+			continue;
 
-		offset += chunk_len;
-		byte_addr = 0;
+		best = bp->len;
+		*sr1 = REG_W25_SRP0 | bp->sr1;
+		*sr2 = bp->sr2;
 	}
-
-	spi_debug("SF: Winbond: Successfully programmed %u bytes @"
-			" 0x%lx\n", len, (unsigned long)(offset - len));
-
-	ret = 0;
-
-out:
-	spi_release_bus(flash->spi);
-	return ret;
-}
-
-static int winbond_erase(struct spi_flash *flash, u32 offset, size_t len)
-{
-	return spi_flash_cmd_erase(flash, CMD_W25_SE, offset, len);
 }
 
-static int winbond_set_lock_flags(struct spi_flash *flash, int lock)
+/*
+ * With temporary set the new protection only goes to the volatile status
+ * register bits: it takes effect at once and the non-volatile bits keep
+ * their value, which is restored at the next power up.
+ */
+static int winbond_set_lock_flags(struct spi_flash *flash, int lock,
+				  int temporary)
 {
 	int ret;
-	u8 cmd;
 	u8 status[2];
+	u8 bits[2] = { 0, 0 };
 
 	flash->spi->rw = SPI_WRITE_FLAG;
 	ret = spi_claim_bus(flash->spi);
@@ -177,40 +155,25 @@ static int winbond_set_lock_flags(struct spi_flash *flash, int lock)
 		return ret;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_RDSR1, &status[0], 1);
+	ret = spi_flash_read_sr(flash, 0, &status[0]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 1\n");
 		goto out;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_RDSR2, &status[1], 1);
+	ret = spi_flash_read_sr(flash, 1, &status[1]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 2\n");
 		goto out;
 	}
 
-	if (lock) {
-		status[0] |= REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0;
-	} else {
-		status[0] &= ~(REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0);
-	}
-
-	status[0] &= ~(REG_W25_SEC | REG_W25_TB);
-	status[1] &= ~(REG_W25_SRP1 | REG_W25_CMP);
+	if (lock)
+		winbond_lock_bits(flash, &bits[0], &bits[1]);
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_WREN, NULL, 0);
-	if (ret < 0) {
-		spi_debug("SF: Enabling Write failed\n");
-		goto out;
-	}
+	status[0] = (status[0] & ~REG_W25_LOCK_MASK) | bits[0];
+	status[1] = (status[1] & ~(REG_W25_SRP1 | REG_W25_CMP)) | bits[1];
 
-	cmd = CMD_W25_WRSR;
-	ret = spi_flash_cmd_write(flash->spi, &cmd, sizeof(cmd),
-				  status, sizeof(status));
-	if (ret < 0) {
-		spi_debug("SF: Status register write failed\n");
-		goto out;
-	}
+	ret = spi_flash_write_sr(flash, status, sizeof(status), temporary);
 
 out:
 	spi_release_bus(flash->spi);
@@ -219,26 +182,78 @@ out:
 
 static int winbond_unlock(struct spi_flash *flash)
 {
-	return winbond_set_lock_flags(flash, 0);
+	return winbond_set_lock_flags(flash, 0, 0);
 }
 
 static int winbond_lock(struct spi_flash *flash)
 {
-	return winbond_set_lock_flags(flash, 1);
+	return winbond_set_lock_flags(flash, 1, 0);
+}
+
+static int winbond_unlock_volatile(struct spi_flash *flash)
+{
+	return winbond_set_lock_flags(flash, 0, 1);
+}
+
+static int winbond_lock_volatile(struct spi_flash *flash)
+{
+	return winbond_set_lock_flags(flash, 1, 1);
 }
 
 static int winbond_is_locked(struct spi_flash *flash)
 {
-	u8 status = 0;
+	u8 status[2] = { 0, 0 };
+	u8 bits[2];
 
-	spi_flash_cmd(flash->spi, CMD_W25_RDSR1, &status, 1);
+	spi_flash_read_sr(flash, 0, &status[0]);
 
-	if ((status & (REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0))
+	if ((status[0] & (REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0))
 	           == (REG_W25_SRP0 | REG_W25_BP2 | REG_W25_BP1 | REG_W25_BP0)) {
 		return 1;
 	}
 
-	return 0;
+	/* Or the layout lock() picks to keep the bootorder writable */
+	if (!flash->wp_keep_len || !winbond_is_w25q(flash))
+		return 0;
+
+	spi_flash_read_sr(flash, 1, &status[1]);
+	winbond_lock_bits(flash, &bits[0], &bits[1]);
+
+	return (status[0] & REG_W25_LOCK_MASK) == bits[0] &&
+	       (status[1] & REG_W25_CMP) == bits[1];
+}
+
+static int winbond_is_writable(struct spi_flash *flash, u32 offset,
+			       size_t len)
+{
+	const struct spi_flash_bp *bp;
+	u8 status[2];
+
+	if (spi_flash_read_sr(flash, 0, &status[0]) ||
+	    spi_flash_read_sr(flash, 1, &status[1]))
+		return 0;
+
+	bp = spi_flash_bp_lookup(flash, status[0], status[1]);
+	if (!bp)
+		return !winbond_is_locked(flash);
+
+	/* Callers may pass the CPU address */
+	offset &= flash->size - 1;
+
+	return bp->start >= offset + len || offset >= bp->start + bp->len;
+}
+
+/* Security registers are 256 byte pages, the offset is reg << 8 | addr */
+#define W25_SEC_PAGE	256
+
+static int winbond_sec_reg_ok(u8 reg)
+{
+	if (reg != ADDR_W25_SEC1 && reg != ADDR_W25_SEC2 && reg != ADDR_W25_SEC3) {
+		spi_debug("SF: Wrong security register\n");
+		return 0;
+	}
+
+	return 1;
 }
 
 static int winbond_sec_read(struct spi_flash *flash, u32 offset, size_t len, void *buf)
@@ -247,17 +262,10 @@ static int winbond_sec_read(struct spi_flash *flash, u32 offset, size_t len, voi
 	u8 cmd[5];
 	u8 reg = (offset >> 8) & 0xFF;
 	u8 addr = offset & 0xFF;
+	size_t chunk;
 
-	if (reg != ADDR_W25_SEC1 && reg != ADDR_W25_SEC2 && reg != ADDR_W25_SEC3) {
-		spi_debug("SF: Wrong security register\n");
+	if (!winbond_sec_reg_ok(reg) || len > W25_SEC_PAGE - addr)
 		return 1;
-	}
-
-	cmd[0] = CMD_W25_RD_SEC;
-	cmd[1] = 0x0;
-	cmd[2] = reg;
-	cmd[3] = addr;
-	cmd[4] = 0x0; // dummy byte needed for this instruction
 
 	flash->spi->rw = SPI_READ_FLAG;
 	ret = spi_claim_bus(flash->spi);
@@ -266,37 +274,38 @@ static int winbond_sec_read(struct spi_flash *flash, u32 offset, size_t len, voi
 		return ret;
 	}
 
-	ret = spi_flash_cmd_read(flash->spi, cmd, sizeof(cmd), buf, len);
-	if (ret) {
-		spi_debug("SF: Can't read sec register %d\n", reg >> 4);
-		goto out;
+	/* As much as the controller FIFO takes per transaction */
+	for (; len; addr += chunk, buf += chunk, len -= chunk) {
+		chunk = spi_crop_chunk(flash->spi, sizeof(cmd), len);
+
+		cmd[0] = CMD_W25_RD_SEC;
+		cmd[1] = 0x0;
+		cmd[2] = reg;
+		cmd[3] = addr;
+		cmd[4] = 0x0; // dummy byte needed for this instruction
+
+		ret = spi_flash_cmd_read(flash->spi, cmd, sizeof(cmd), buf, chunk);
+		if (ret) {
+			spi_debug("SF: Can't read sec register %d\n", reg >> 4);
+			break;
+		}
 	}
 
-out:
 	spi_release_bus(flash->spi);
 	return ret;
 }
 
+/* Program only, the register has to be erased with sec_erase() first */
 static int winbond_sec_program(struct spi_flash *flash, u32 offset, size_t len, const void *buf)
 {
 	int ret = 1;
 	u8 cmd[4];
 	u8 reg = (offset >> 8) & 0xFF;
 	u8 addr = offset & 0xFF;
-	u32 tmp_sect_size = flash->sector_size;
+	size_t chunk;
 
-	if (reg != ADDR_W25_SEC1 && reg != ADDR_W25_SEC2 && reg != ADDR_W25_SEC3) {
-		spi_debug("SF: Wrong security register\n");
+	if (!winbond_sec_reg_ok(reg) || len > W25_SEC_PAGE - addr)
 		return 1;
-	}
-
-	flash->sector_size = 1;
-	ret = spi_flash_cmd_erase(flash, CMD_W25_ER_SEC, offset & (0xFF << 8), 1);
-	flash->sector_size = tmp_sect_size;
-	if (ret) {
-		spi_debug("SF: Can't erase sec reg\n");
-		return ret;
-	}
 
 	flash->spi->rw = SPI_WRITE_FLAG;
 	ret = spi_claim_bus(flash->spi);
@@ -305,29 +314,32 @@ static int winbond_sec_program(struct spi_flash *flash, u32 offset, size_t len,
 		return ret;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_WREN, NULL, 0);
-	if (ret) {
-		spi_debug("SF: Enabling Write failed\n");
-		goto out;
-	}
+	for (; len; addr += chunk, buf += chunk, len -= chunk) {
+		chunk = spi_crop_chunk(flash->spi, sizeof(cmd), len);
 
-	cmd[0] = CMD_W25_WR_SEC;
-	cmd[1] = 0x0;
-	cmd[2] = reg;
-	cmd[3] = addr;
-	ret = spi_flash_cmd_write(flash->spi, cmd, sizeof(cmd), buf, len);
-	if (ret) {
-		spi_debug("SF: Can't write to sec register %d\n", reg >> 4);
-		goto out;
-	}
+		ret = spi_flash_cmd(flash->spi, CMD_W25_WREN, NULL, 0);
+		if (ret) {
+			spi_debug("SF: Enabling Write failed\n");
+			break;
+		}
 
-	ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-	if (ret) {
-		spi_debug("SF: Programming sec register failed - timeout\n");
-		goto out;
+		cmd[0] = CMD_W25_WR_SEC;
+		cmd[1] = 0x0;
+		cmd[2] = reg;
+		cmd[3] = addr;
+		ret = spi_flash_cmd_write(flash->spi, cmd, sizeof(cmd), buf, chunk);
+		if (ret) {
+			spi_debug("SF: Can't write to sec register %d\n", reg >> 4);
+			break;
+		}
+
+		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+		if (ret) {
+			spi_debug("SF: Programming sec register failed - timeout\n");
+			break;
+		}
 	}
 
-out:
 	spi_release_bus(flash->spi);
 	return ret;
 }
@@ -338,10 +350,8 @@ static int winbond_sec_erase(struct spi_flash *flash, u32 offset, size_t len)
 	u8 reg = (offset >> 8) & 0xFF;
 	u32 tmp_sect_size = flash->sector_size;
 
-	if (reg != ADDR_W25_SEC1 && reg != ADDR_W25_SEC2 && reg != ADDR_W25_SEC3) {
-		spi_debug("SF: Wrong security register\n");
+	if (!winbond_sec_reg_ok(reg))
 		return 1;
-	}
 
 	flash->sector_size = 1;
 	ret = spi_flash_cmd_erase(flash, CMD_W25_ER_SEC, offset & (0xFF << 8), 1);
@@ -358,7 +368,7 @@ static int winbond_sec_sts(struct spi_flash *flash)
 	u8 status = 0;
 	int ret;
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_RDSR2, &status, 1);
+	ret = spi_flash_read_sr(flash, 1, &status);
 	if (ret) {
 		return -1;
 	}
@@ -371,7 +381,6 @@ static int winbond_sec_sts(struct spi_flash *flash)
 static int winbond_sec_lock(struct spi_flash *flash, u8 reg)
 {
 	int ret;
-	u8 cmd;
 	u8 status[2];
 
 	flash->spi->rw = SPI_WRITE_FLAG;
@@ -381,13 +390,13 @@ static int winbond_sec_lock(struct spi_flash *flash, u8 reg)
 		return ret;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_RDSR1, &status[0], 1);
+	ret = spi_flash_read_sr(flash, 0, &status[0]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 1\n");
 		goto out;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_RDSR2, &status[1], 1);
+	ret = spi_flash_read_sr(flash, 1, &status[1]);
 	if (ret) {
 		spi_debug("SF: Unable to read Status Register 2\n");
 		goto out;
@@ -408,19 +417,7 @@ static int winbond_sec_lock(struct spi_flash *flash, u8 reg)
 		goto out;
 	}
 
-	ret = spi_flash_cmd(flash->spi, CMD_W25_WREN, NULL, 0);
-	if (ret) {
-		spi_debug("SF: Enabling Write failed\n");
-		goto out;
-	}
-
-	cmd = CMD_W25_WRSR;
-	ret = spi_flash_cmd_write(flash->spi, &cmd, sizeof(cmd),
-				  status, sizeof(status));
-	if (ret) {
-		spi_debug("SF: Status register write failed\n");
-		goto out;
-	}
+	ret = spi_flash_write_sr(flash, status, sizeof(status), 0);
 
 out:
 	spi_release_bus(flash->spi);
@@ -446,7 +443,7 @@ struct spi_flash *spi_flash_probe_winbond(struct spi_slave *spi, u8 *idcode)
 		return NULL;
 	}
 
-	stm = malloc(sizeof(struct winbond_spi_flash));
+	stm = calloc(1, sizeof(struct winbond_spi_flash));
 	if (!stm) {
 		spi_debug("SF: Failed to allocate memory\n");
 		return NULL;
@@ -459,11 +456,24 @@ struct spi_flash *spi_flash_probe_winbond(struct spi_slave *spi, u8 *idcode)
 	/* Assuming power-of-two page size initially. */
 	page_size = 1 << params->l2_page_size;
 
-	stm->flash.write = winbond_write;
+	stm->flash.write = spi_flash_cmd_write_page_program;
+	stm->flash.page_size = page_size;
+	stm->flash.program_cmd = CMD_W25_PP;
 	stm->flash.spi_erase = winbond_erase;
+	stm->flash.erase_cmd = CMD_W25_SE;
 	stm->flash.lock = winbond_lock;
 	stm->flash.unlock = winbond_unlock;
 	stm->flash.is_locked = winbond_is_locked;
+	stm->flash.bp_range = spi_flash_bp_range_w25q;
+	stm->flash.bp_mask[0] = REG_W25_TB | REG_W25_BP_MASK;
+	/* W25X parts have no volatile status register, SEC or CMP */
+	if ((params->id >> 8) != 0x30) {
+		stm->flash.lock_volatile = winbond_lock_volatile;
+		stm->flash.unlock_volatile = winbond_unlock_volatile;
+		stm->flash.is_writable = winbond_is_writable;
+		stm->flash.bp_mask[0] |= REG_W25_SEC;
+		stm->flash.bp_mask[1] = REG_W25_CMP;
+	}
 	stm->flash.sec_sts = winbond_sec_sts;
 	stm->flash.sec_read = winbond_sec_read;
 	stm->flash.sec_prog = winbond_sec_program;
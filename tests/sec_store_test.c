@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Host test of the key-value store in utils/sec_store.c, run by `make test`.
+ * The security register is a byte array that programming can only clear
+ * bits in, as on the flash.
+ */
+
+#include "../utils/crc32.c"
+#include "../utils/sec_store.c"
+
+#define REG_SIZE	256
+
+static u8 reg[REG_SIZE];
+static int reg_locked;
+static unsigned int reg_erases;
+static int failures;
+
+int read_sec_status(void)
+{
+	return reg_locked ? 1 << (SEC_STORE_REG - 1) : 0;
+}
+
+int read_sec(u8 r, u8 addr, void *buf, size_t len)
+{
+	if (r != SEC_STORE_REG || addr + len > REG_SIZE)
+		return -1;
+	memcpy(buf, reg + addr, len);
+	return 0;
+}
+
+int erase_sec(u8 r, u8 addr, size_t len)
+{
+	if (r != SEC_STORE_REG || addr + len > REG_SIZE)
+		return -1;
+	memset(reg + addr, 0xff, len);
+	reg_erases++;
+	return 0;
+}
+
+int prog_sec(u8 r, u8 addr, const void *buf, size_t len)
+{
+	const u8 *p = buf;
+	size_t i;
+
+	if (r != SEC_STORE_REG || addr + len > REG_SIZE)
+		return -1;
+	for (i = 0; i < len; i++)
+		reg[addr + i] &= p[i];
+	return 0;
+}
+
+#define CHECK(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			printf("FAIL %s:%d: ", __func__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			failures++;					\
+		}							\
+	} while (0)
+
+static void erase_reg(void)
+{
+	memset(reg, 0xff, sizeof(reg));
+	reg_locked = 0;
+	reg_erases = 0;
+}
+
+/* Value of key must be the string expected, NULL if unset */
+static void check_value(u8 key, const char *expected, int line)
+{
+	char buf[SEC_STORE_VALUE_MAX + 1];
+	int len = sec_store_get(key, buf, sizeof(buf) - 1);
+
+	if (!expected) {
+		if (len >= 0)
+			printf("FAIL line %d: key %u set\n", line, key);
+		failures += len >= 0;
+		return;
+	}
+
+	if (len < 0 || len != strlen(expected) || memcmp(buf, expected, len)) {
+		buf[len < 0 ? 0 : len] = '\0';
+		printf("FAIL line %d: key %u is \"%s\" (%d), expected \"%s\"\n",
+		       line, key, buf, len, expected);
+		failures++;
+	}
+}
+#define CHECK_VALUE(key, expected) check_value(key, expected, __LINE__)
+
+static int set_str(u8 key, const char *value)
+{
+	return sec_store_set(key, value, strlen(value));
+}
+
+static int count_keys(void)
+{
+	int n = 0;
+	u8 key = 0;
+
+	while ((key = sec_store_next(key)))
+		n++;
+
+	return n;
+}
+
+static void test_empty(void)
+{
+	erase_reg();
+	CHECK(sec_store_load() == 0, "load failed");
+	CHECK(count_keys() == 0, "%d keys in an erased register",
+	      count_keys());
+	CHECK_VALUE(SEC_KEY_SERIAL, NULL);
+}
+
+static void test_legacy_serial(void)
+{
+	/* Older versions wrote the serial zero padded at the start */
+	erase_reg();
+	memcpy(reg, "1234567\0\0\0", 10);
+	CHECK(sec_store_load() == 0, "load failed");
+	CHECK_VALUE(SEC_KEY_SERIAL, "1234567");
+	CHECK(count_keys() == 1, "%d keys", count_keys());
+
+	/* Serial filling all ten bytes, no terminator */
+	erase_reg();
+	memcpy(reg, "ABCDEFGHIJ", 10);
+	CHECK(sec_store_load() == 0, "load failed");
+	CHECK_VALUE(SEC_KEY_SERIAL, "ABCDEFGHIJ");
+
+	/* The import survives a commit and is then read from the store */
+	CHECK(set_str(SEC_KEY_ASSET, "A-1") == 0, "set failed");
+	CHECK(sec_store_commit() == 0, "commit failed");
+	CHECK(!memcmp(reg, "ABCDEFGHIJ\0\0\0\0\0\0", SEC_STORE_SERIAL_LEN),
+	      "serial string not kept in front of the store");
+	memset(page, 0, sizeof(page));
+	CHECK(sec_store_load() == 0, "reload failed");
+	CHECK_VALUE(SEC_KEY_SERIAL, "ABCDEFGHIJ");
+	CHECK_VALUE(SEC_KEY_ASSET, "A-1");
+}
+
+static void test_set_replace_remove(void)
+{
+	erase_reg();
+	sec_store_load();
+
+	CHECK(set_str(SEC_KEY_SERIAL, "S1") == 0, "set failed");
+	CHECK(set_str(SEC_KEY_ASSET, "asset") == 0, "set failed");
+	CHECK(set_str(SEC_KEY_DATE, "2026-10-19") == 0, "set failed");
+
+	/* Longer and shorter replacements leave the others intact */
+	CHECK(set_str(SEC_KEY_SERIAL, "SERIAL-LONGER") == 0, "replace failed");
+	CHECK_VALUE(SEC_KEY_SERIAL, "SERIAL-LONGER");
+	CHECK_VALUE(SEC_KEY_ASSET, "asset");
+	CHECK_VALUE(SEC_KEY_DATE, "2026-10-19");
+	CHECK(set_str(SEC_KEY_ASSET, "a") == 0, "replace failed");
+	CHECK_VALUE(SEC_KEY_ASSET, "a");
+	CHECK_VALUE(SEC_KEY_DATE, "2026-10-19");
+	CHECK(count_keys() == 3, "%d keys", count_keys());
+
+	/* A zero length removes, removing an unset key is fine */
+	CHECK(sec_store_set(SEC_KEY_SERIAL, NULL, 0) == 0, "remove failed");
+	CHECK_VALUE(SEC_KEY_SERIAL, NULL);
+	CHECK_VALUE(SEC_KEY_ASSET, "a");
+	CHECK_VALUE(SEC_KEY_DATE, "2026-10-19");
+	CHECK(sec_store_set(SEC_KEY_MAC4, NULL, 0) == 0, "remove failed");
+	CHECK(count_keys() == 2, "%d keys", count_keys());
+
+	/* Short buffers get a truncated copy */
+	{
+		char buf[3];
+
+		CHECK(sec_store_get(SEC_KEY_DATE, buf, sizeof(buf)) == 3 &&
+		      !memcmp(buf, "202", 3), "truncated get");
+	}
+}
+
+static void test_limits(void)
+{
+	u8 value[SEC_STORE_VALUE_MAX + 1];
+	u8 key;
+	int ret;
+
+	erase_reg();
+	sec_store_load();
+	memset(value, 'x', sizeof(value));
+
+	CHECK(sec_store_set(0, "x", 1) < 0, "key 0 accepted");
+	CHECK(sec_store_set(SEC_KEY_ASSET, value, SEC_STORE_VALUE_MAX + 1) < 0,
+	      "value over the maximum accepted");
+	CHECK(sec_store_set(SEC_KEY_SERIAL, value, SEC_STORE_SERIAL_LEN) < 0,
+	      "serial without room for its terminator accepted");
+	CHECK(sec_store_set(SEC_KEY_SERIAL, value,
+			    SEC_STORE_SERIAL_LEN - 1) == 0,
+	      "longest serial refused");
+
+	/* Fill with maximum size values until the page is full */
+	for (key = 0x20; ; key++) {
+		ret = sec_store_set(key, value, SEC_STORE_VALUE_MAX);
+		if (ret)
+			break;
+	}
+	CHECK(header->len <= SEC_STORE_DATA_MAX, "store overflows the page");
+
+	/* A refused set leaves the store unchanged */
+	ret = header->len;
+	CHECK(sec_store_set(key, value, SEC_STORE_VALUE_MAX) < 0,
+	      "set past the end accepted");
+	CHECK(header->len == ret, "refused set changed the store");
+
+	/* The remaining room fits exactly, one byte more does not */
+	ret = SEC_STORE_DATA_MAX - header->len - 2;
+	CHECK(ret >= 0 && ret < SEC_STORE_VALUE_MAX, "room %d", ret);
+	CHECK(sec_store_set(key, value, ret + 1) < 0, "overfull set accepted");
+	CHECK(sec_store_set(key, value, ret) == 0, "exact fit refused");
+	CHECK(header->len == SEC_STORE_DATA_MAX, "store not full");
+
+	/* A full store can still replace a value in its own space */
+	CHECK(sec_store_set(0x20, value, SEC_STORE_VALUE_MAX) == 0,
+	      "replace in a full store refused");
+	CHECK(sec_store_set(0x20, value, 10) == 0, "shrink refused");
+	CHECK(sec_store_set(key, value, ret + 1) == 0,
+	      "freed room not reused");
+
+	/* And a full store commits and loads back */
+	CHECK(sec_store_commit() == 0, "commit of a full store failed");
+	ret = header->len;
+	memset(page, 0, sizeof(page));
+	CHECK(sec_store_load() == 0 && header->len == ret,
+	      "full store not loaded back");
+}
+
+static void test_commit(void)
+{
+	erase_reg();
+	sec_store_load();
+
+	/* Without a serial the legacy area stays erased */
+	set_str(SEC_KEY_ASSET, "asset");
+	CHECK(sec_store_commit() == 0, "commit failed");
+	CHECK(reg_erases == 1, "%u erases for one commit", reg_erases);
+	CHECK(reg[0] == 0xff && reg[SEC_STORE_SERIAL_LEN - 1] == 0xff,
+	      "legacy serial area written");
+	CHECK(reg[REG_SIZE - 1] == 0xff, "page end written");
+
+	/* A damaged store loads as empty */
+	reg[SEC_STORE_DATA + 2] ^= 0x01;
+	CHECK(sec_store_load() == 0, "load failed");
+	CHECK(count_keys() == 0, "%d keys from a damaged store",
+	      count_keys());
+
+	/* A locked register is left alone */
+	erase_reg();
+	sec_store_load();
+	set_str(SEC_KEY_ASSET, "asset");
+	reg_locked = 1;
+	CHECK(sec_store_commit() < 0, "commit to a locked register");
+	CHECK(reg_erases == 0 && reg[0] == 0xff, "locked register written");
+}
+
+int main(void)
+{
+	test_empty();
+	test_legacy_serial();
+	test_set_replace_remove();
+	test_limits();
+	test_commit();
+
+	if (failures) {
+		printf("sec_store_test: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("sec_store_test: OK\n");
+	return 0;
+}
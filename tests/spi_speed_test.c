@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Host test of the SPI100 speed and read mode programming in spi/spi.c,
+ * run by `make test`. The controller registers are a plain byte array.
+ */
+
+#include "../spi/spi.c"
+
+#define REG_CNTRL0		0x00
+#define REG_SPI100_ENABLE	0x20
+#define REG_SPEED_CONFIG	0x22
+
+#define FW_SPEED_CONFIG		0x5555	/* 800 kHz everywhere */
+#define FW_CNTRL0		0x00000042	/* normal read */
+
+static u8 regs[0x100];
+static unsigned int reg_writes;
+static int failures;
+
+u8 readb(u32 addr)
+{
+	return regs[addr];
+}
+
+u16 readw(u32 addr)
+{
+	return regs[addr] | regs[addr + 1] << 8;
+}
+
+u32 readl(u32 addr)
+{
+	return readw(addr) | (u32)readw(addr + 2) << 16;
+}
+
+void writeb(u8 val, u32 addr)
+{
+	regs[addr] = val;
+	reg_writes++;
+}
+
+void writew(u16 val, u32 addr)
+{
+	regs[addr] = val;
+	regs[addr + 1] = val >> 8;
+	reg_writes++;
+}
+
+void writel(u32 val, u32 addr)
+{
+	regs[addr] = val;
+	regs[addr + 1] = val >> 8;
+	regs[addr + 2] = val >> 16;
+	regs[addr + 3] = val >> 24;
+	reg_writes++;
+}
+
+#define CHECK(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			printf("FAIL %s:%d: ", __func__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			failures++;					\
+		}							\
+	} while (0)
+
+static void reset_controller(int spi100)
+{
+	memset(regs, 0, sizeof(regs));
+	writew(FW_SPEED_CONFIG, REG_SPEED_CONFIG);
+	writel(FW_CNTRL0, REG_CNTRL0);
+	regs[REG_SPI100_ENABLE] = spi100 ? SPI100_USE_SPI100 : 0;
+	reg_writes = 0;
+}
+
+static void check_restored(void)
+{
+	CHECK(readw(REG_SPEED_CONFIG) == FW_SPEED_CONFIG,
+	      "speed config %04x not restored", readw(REG_SPEED_CONFIG));
+	CHECK(readl(REG_CNTRL0) == FW_CNTRL0,
+	      "cntrl0 %08x not restored", readl(REG_CNTRL0));
+}
+
+static void test_speed_codes(void)
+{
+	static const struct {
+		unsigned int hz;
+		u16 speed;	/* NormSpeed, FastSpeed, firmware's Alt/Tpm */
+		int fast_read;
+	} cases[] = {
+		{ 100000000, 0x1055, 1 },	/* normal read stays at 33 MHz */
+		{  66000000, 0x1055, 1 },
+		{  50000000, 0x1155, 1 },
+		{  33000000, 0x1155, 0 },
+		{  25000000, 0x2255, 0 },
+		{  22000000, 0x2255, 0 },
+		{  20000000, 0x3355, 0 },
+		{  16500000, 0x3355, 0 },
+		{  10000000, 0x5555, 0 },
+		{    100000, 0x5555, 0 },	/* nothing slower than 800 kHz */
+	};
+	struct spi_slave slave;
+	unsigned int i;
+	u32 cntrl0;
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		reset_controller(1);
+		memset(&slave, 0, sizeof(slave));
+		slave.max_hz = cases[i].hz;
+
+		spi_claim_bus(&slave);
+		CHECK(readw(REG_SPEED_CONFIG) == cases[i].speed,
+		      "%u Hz: speed config %04x, expected %04x", cases[i].hz,
+		      readw(REG_SPEED_CONFIG), cases[i].speed);
+
+		cntrl0 = readl(REG_CNTRL0);
+		if (cases[i].fast_read)
+			CHECK(cntrl0 == (FW_CNTRL0 | SPI_READ_MODE_FAST),
+			      "%u Hz: cntrl0 %08x, no fast read", cases[i].hz,
+			      cntrl0);
+		else
+			CHECK(cntrl0 == FW_CNTRL0,
+			      "%u Hz: cntrl0 %08x changed", cases[i].hz,
+			      cntrl0);
+
+		spi_release_bus(&slave);
+		check_restored();
+	}
+}
+
+static void test_nesting(void)
+{
+	struct spi_slave slave;
+
+	reset_controller(1);
+	memset(&slave, 0, sizeof(slave));
+	slave.max_hz = 66000000;
+	slave.rw = SPI_READ_FLAG;
+
+	spi_claim_bus(&slave);
+	slave.rw = SPI_WRITE_FLAG;
+	spi_claim_bus(&slave);
+	CHECK(slave.claim_depth == 2 && slave.write_depth == 2,
+	      "depth %u, write depth %u", slave.claim_depth,
+	      slave.write_depth);
+
+	/* An inner claim must not save the programmed speed as firmware's */
+	spi_claim_bus(&slave);
+	spi_release_bus(&slave);
+	CHECK(readw(REG_SPEED_CONFIG) == 0x1055,
+	      "speed config %04x after inner release",
+	      readw(REG_SPEED_CONFIG));
+
+	spi_release_bus(&slave);
+	CHECK(slave.write_depth == 0, "write depth %u", slave.write_depth);
+	CHECK(readw(REG_SPEED_CONFIG) == 0x1055,
+	      "speed config %04x restored too early",
+	      readw(REG_SPEED_CONFIG));
+
+	/* A new speed applies right away and still restores firmware's */
+	spi_set_speed(&slave, 22000000);
+	CHECK(readw(REG_SPEED_CONFIG) == 0x2255,
+	      "speed config %04x after spi_set_speed()",
+	      readw(REG_SPEED_CONFIG));
+	CHECK(readl(REG_CNTRL0) == FW_CNTRL0,
+	      "cntrl0 %08x keeps fast read", readl(REG_CNTRL0));
+
+	spi_release_bus(&slave);
+	CHECK(slave.claim_depth == 0, "depth %u", slave.claim_depth);
+	check_restored();
+
+	/* Unbalanced releases are ignored */
+	spi_release_bus(&slave);
+	CHECK(slave.claim_depth == 0, "depth %u", slave.claim_depth);
+	check_restored();
+}
+
+static void test_untouched(void)
+{
+	struct spi_slave slave;
+
+	/* Firmware's settings are kept without SPI100 or a speed */
+	reset_controller(0);
+	memset(&slave, 0, sizeof(slave));
+	slave.max_hz = 66000000;
+	spi_claim_bus(&slave);
+	spi_set_speed(&slave, 33000000);
+	spi_release_bus(&slave);
+	CHECK(reg_writes == 0, "%u writes with SPI100 disabled", reg_writes);
+	check_restored();
+
+	reset_controller(1);
+	slave.max_hz = 0;
+	spi_claim_bus(&slave);
+	spi_release_bus(&slave);
+	CHECK(reg_writes == 0, "%u writes without a speed", reg_writes);
+
+	/* Unclaimed, the speed is only applied by the next claim */
+	spi_set_speed(&slave, 66000000);
+	CHECK(reg_writes == 0, "%u writes while unclaimed", reg_writes);
+}
+
+int main(void)
+{
+	test_speed_codes();
+	test_nesting();
+	test_untouched();
+
+	if (failures) {
+		printf("spi_speed_test: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("spi_speed_test: OK\n");
+	return 0;
+}
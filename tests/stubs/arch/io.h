@@ -0,0 +1 @@
+#include <libpayload.h>
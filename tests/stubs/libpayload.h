@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* The parts of libpayload the host tests build against */
+
+#ifndef TESTS_LIBPAYLOAD_H
+#define TESTS_LIBPAYLOAD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/* Register accesses go to the fake register file of the test */
+u8 readb(u32 addr);
+u16 readw(u32 addr);
+u32 readl(u32 addr);
+void writeb(u8 val, u32 addr);
+void writew(u16 val, u32 addr);
+void writel(u32 val, u32 addr);
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TESTS_PCI_H
+#define TESTS_PCI_H
+
+#include <libpayload.h>
+
+typedef u32 pcidev_t;
+
+#define PCI_DEV(bus, dev, fn) (((bus) << 16) | ((dev) << 11) | ((fn) << 8))
+
+/* The SPI BAR reads as 0, the fake register file starts there */
+static inline u8 pci_read_config8(pcidev_t dev, u16 reg) { return 0; }
+static inline u32 pci_read_config32(pcidev_t dev, u16 reg) { return 0; }
+static inline void pci_write_config8(pcidev_t dev, u16 reg, u8 val) { }
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <blake2s.h>
+
+#define CPUID_EDX_SSE2		(1 << 26)
+#define CR0_MP			(1 << 1)
+#define CR0_EM			(1 << 2)
+#define CR4_OSFXSR		(1 << 9)
+#define CR4_OSXMMEXCPT		(1 << 10)
+
+static const u32 blake2s_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const u8 blake2s_sigma[10][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+};
+
+typedef void (*blake2s_compress_fn)(u32 *h, const u8 *block, const u32 *t,
+				    u32 f0);
+
+static blake2s_compress_fn blake2s_compress;
+
+static inline u32 ror32(u32 x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+#define G(a, b, c, d, x, y)			\
+	do {					\
+		a += b + x;			\
+		d = ror32(d ^ a, 16);		\
+		c += d;				\
+		b = ror32(b ^ c, 12);		\
+		a += b + y;			\
+		d = ror32(d ^ a, 8);		\
+		c += d;				\
+		b = ror32(b ^ c, 7);		\
+	} while (0)
+
+static void blake2s_compress_generic(u32 *h, const u8 *block, const u32 *t,
+				     u32 f0)
+{
+	const u8 *s;
+	u32 m[16], v[16];
+	int i;
+
+	for (i = 0; i < 16; i++)
+		m[i] = le32toh(*(const u32 *)(block + 4 * i));
+
+	for (i = 0; i < 8; i++) {
+		v[i] = h[i];
+		v[i + 8] = blake2s_iv[i];
+	}
+	v[12] ^= t[0];
+	v[13] ^= t[1];
+	v[14] ^= f0;
+
+	for (i = 0; i < 10; i++) {
+		s = blake2s_sigma[i];
+		G(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]]);
+		G(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]]);
+		G(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]]);
+		G(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]]);
+		G(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]]);
+		G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+		G(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]]);
+		G(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]]);
+	}
+
+	for (i = 0; i < 8; i++)
+		h[i] ^= v[i] ^ v[i + 8];
+}
+
+/*
+ * One row of the state per XMM register, so each G step works on all four
+ * columns or diagonals at once. GCC vector extensions keep this free of the
+ * intrinsics headers, the target attribute lets it use SSE2 even though the
+ * rest of the payload is built without.
+ */
+typedef u32 v4u32 __attribute__((vector_size(16)));
+typedef u32 v4u32_unaligned __attribute__((vector_size(16), aligned(4)));
+
+#define VROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+#define VG(a, b, c, d, x, y)			\
+	do {					\
+		a += b + x;			\
+		d = VROR(d ^ a, 16);		\
+		c += d;				\
+		b = VROR(b ^ c, 12);		\
+		a += b + y;			\
+		d = VROR(d ^ a, 8);		\
+		c += d;				\
+		b = VROR(b ^ c, 7);		\
+	} while (0)
+
+__attribute__((target("sse2")))
+static void blake2s_compress_sse2(u32 *h, const u8 *block, const u32 *t,
+				  u32 f0)
+{
+	const v4u32 rot1 = { 1, 2, 3, 0 }, rot2 = { 2, 3, 0, 1 },
+		    rot3 = { 3, 0, 1, 2 };
+	const u32 *m = (const u32 *)block;
+	v4u32_unaligned *hv = (v4u32_unaligned *)h;
+	v4u32 a, b, c, d;
+	const u8 *s;
+	int i;
+
+	a = hv[0];
+	b = hv[1];
+	c = *(const v4u32_unaligned *)&blake2s_iv[0];
+	d = *(const v4u32_unaligned *)&blake2s_iv[4] ^
+	    (v4u32){ t[0], t[1], f0, 0 };
+
+	for (i = 0; i < 10; i++) {
+		s = blake2s_sigma[i];
+		VG(a, b, c, d,
+		   ((v4u32){ m[s[0]], m[s[2]], m[s[4]], m[s[6]] }),
+		   ((v4u32){ m[s[1]], m[s[3]], m[s[5]], m[s[7]] }));
+
+		/* Diagonals into the columns */
+		b = __builtin_shuffle(b, rot1);
+		c = __builtin_shuffle(c, rot2);
+		d = __builtin_shuffle(d, rot3);
+
+		VG(a, b, c, d,
+		   ((v4u32){ m[s[8]], m[s[10]], m[s[12]], m[s[14]] }),
+		   ((v4u32){ m[s[9]], m[s[11]], m[s[13]], m[s[15]] }));
+
+		b = __builtin_shuffle(b, rot3);
+		c = __builtin_shuffle(c, rot2);
+		d = __builtin_shuffle(d, rot1);
+	}
+
+	hv[0] ^= a ^ c;
+	hv[1] ^= b ^ d;
+}
+
+/* SSE2 if the CPU has it, turning on SSE in CR4 if nobody did before */
+static blake2s_compress_fn blake2s_pick(void)
+{
+	u32 eax = 1, ebx, ecx = 0, edx, cr;
+
+	asm volatile ("cpuid"
+		      : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	if (!(edx & CPUID_EDX_SSE2))
+		return blake2s_compress_generic;
+
+	asm volatile ("mov %%cr4, %0" : "=r" (cr));
+	if (!(cr & CR4_OSFXSR)) {
+		cr |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+		asm volatile ("mov %0, %%cr4" :: "r" (cr));
+		asm volatile ("mov %%cr0, %0" : "=r" (cr));
+		cr = (cr & ~CR0_EM) | CR0_MP;
+		asm volatile ("mov %0, %%cr0" :: "r" (cr));
+	}
+
+	return blake2s_compress_sse2;
+}
+
+const char *blake2s_impl(void)
+{
+	return blake2s_compress == blake2s_compress_sse2 ? "SSE2" : "generic";
+}
+
+void blake2s_init(struct blake2s_state *s)
+{
+	int i;
+
+	if (!blake2s_compress)
+		blake2s_compress = blake2s_pick();
+
+	memset(s, 0, sizeof(*s));
+	for (i = 0; i < 8; i++)
+		s->h[i] = blake2s_iv[i];
+	/* No key, no salt, digest length 32, fanout and depth 1 */
+	s->h[0] ^= 0x01010000 | BLAKE2S_HASH_SIZE;
+}
+
+static void blake2s_block(struct blake2s_state *s, const u8 *block, u32 len,
+			  u32 f0)
+{
+	s->t[0] += len;
+	if (s->t[0] < len)
+		s->t[1]++;
+	blake2s_compress(s->h, block, s->t, f0);
+}
+
+void blake2s_update(struct blake2s_state *s, const void *data, size_t len)
+{
+	const u8 *in = data;
+	size_t fill = BLAKE2S_BLOCK_SIZE - s->buflen;
+
+	/* The last block is kept back, blake2s_final() flags it */
+	if (len > fill) {
+		memcpy(s->buf + s->buflen, in, fill);
+		blake2s_block(s, s->buf, BLAKE2S_BLOCK_SIZE, 0);
+		s->buflen = 0;
+		in += fill;
+		len -= fill;
+
+		for (; len > BLAKE2S_BLOCK_SIZE; in += BLAKE2S_BLOCK_SIZE,
+		     len -= BLAKE2S_BLOCK_SIZE)
+			blake2s_block(s, in, BLAKE2S_BLOCK_SIZE, 0);
+	}
+
+	memcpy(s->buf + s->buflen, in, len);
+	s->buflen += len;
+}
+
+void blake2s_final(struct blake2s_state *s, u8 *digest)
+{
+	int i;
+
+	memset(s->buf + s->buflen, 0, BLAKE2S_BLOCK_SIZE - s->buflen);
+	blake2s_block(s, s->buf, s->buflen, ~0);
+
+	for (i = 0; i < 8; i++) {
+		digest[4 * i] = s->h[i];
+		digest[4 * i + 1] = s->h[i] >> 8;
+		digest[4 * i + 2] = s->h[i] >> 16;
+		digest[4 * i + 3] = s->h[i] >> 24;
+	}
+}
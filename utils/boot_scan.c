@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <boot_scan.h>
+
+#define PCI_ROOT		"/pci@i0cf8"
+
+/* Config space registers */
+#define CFG_VENDOR_ID		0x00
+#define CFG_COMMAND		0x04
+#define  CFG_COMMAND_MEMORY	(1 << 1)
+#define CFG_CLASS_REVISION	0x08
+#define CFG_HEADER_TYPE		0x0e
+#define  CFG_HEADER_BRIDGE	1
+#define CFG_BAR0		0x10
+#define CFG_BAR5		0x24
+#define CFG_SECONDARY_BUS	0x19
+
+#define PCI_CLASS_AHCI		0x010601
+#define PCI_CLASS_SDHCI		0x0805
+#define PCI_CLASS_EHCI		0x0c0320
+#define PCI_CLASS_XHCI		0x0c0330
+
+#define AHCI_PI			0x0c
+#define AHCI_PXSSTS(port)	(0x100 + (port) * 0x80 + 0x28)
+#define AHCI_DET_PRESENT	3
+
+#define SDHCI_PRESENT_STATE	0x24
+#define SDHCI_CARD_INSERTED	(1 << 16)
+
+#define EHCI_PORTSC(port)	(0x44 + (port) * 4)
+#define EHCI_PORT_OWNER		(1 << 13)
+
+#define XHCI_HCSPARAMS1		0x04
+#define XHCI_PORTSC(port)	(0x400 + (port) * 0x10)
+
+#define PORT_CONNECTED		(1 << 0)
+
+/* Memory BAR of a function, 0 if it is unassigned or not decoded */
+static u32 pci_mmio_bar(pcidev_t dev, u16 reg)
+{
+	u32 bar = pci_read_config32(dev, reg);
+
+	if (!(pci_read_config16(dev, CFG_COMMAND) & CFG_COMMAND_MEMORY) ||
+	    (bar & 1))
+		return 0;
+
+	// 64-bit BAR above 4 GiB
+	if ((bar & 6) == 4 && pci_read_config32(dev, reg + 4))
+		return 0;
+
+	return bar & ~0xf;
+}
+
+static enum boot_path_state ahci_port_state(pcidev_t dev, u32 port)
+{
+	u32 abar = pci_mmio_bar(dev, CFG_BAR5);
+
+	if (!abar || port > 31)
+		return BOOT_PATH_UNKNOWN;
+
+	if (!(readl(abar + AHCI_PI) & (1 << port)) ||
+	    (readl(abar + AHCI_PXSSTS(port)) & 0xf) != AHCI_DET_PRESENT)
+		return BOOT_PATH_ABSENT;
+
+	return BOOT_PATH_PRESENT;
+}
+
+static enum boot_path_state sdhci_card_state(pcidev_t dev)
+{
+	u32 bar = pci_mmio_bar(dev, CFG_BAR0);
+
+	if (!bar)
+		return BOOT_PATH_UNKNOWN;
+
+	if (!(readl(bar + SDHCI_PRESENT_STATE) & SDHCI_CARD_INSERTED))
+		return BOOT_PATH_ABSENT;
+
+	return BOOT_PATH_PRESENT;
+}
+
+/* SeaBIOS numbers the root hub ports from 1 */
+static enum boot_path_state usb_port_state(pcidev_t dev, u32 class, u32 port)
+{
+	u32 bar = pci_mmio_bar(dev, CFG_BAR0);
+	u32 op, portsc;
+
+	if (!bar || !port)
+		return BOOT_PATH_UNKNOWN;
+
+	op = bar + readb(bar);
+	port--;
+
+	if (class == PCI_CLASS_XHCI) {
+		if (port >= readl(bar + XHCI_HCSPARAMS1) >> 24)
+			return BOOT_PATH_ABSENT;
+		portsc = readl(op + XHCI_PORTSC(port));
+	} else {
+		if (port >= (readl(bar + 4) & 0xf))
+			return BOOT_PATH_ABSENT;
+		portsc = readl(op + EHCI_PORTSC(port));
+		// handed over to a companion controller
+		if (portsc & EHCI_PORT_OWNER)
+			return BOOT_PATH_UNKNOWN;
+	}
+
+	return (portsc & PORT_CONNECTED) ? BOOT_PATH_PRESENT : BOOT_PATH_ABSENT;
+}
+
+/* Parse "/name@unit[,fn]", returns the end of the component or NULL */
+static const char *parse_component(const char *p, u32 *unit, u32 *fn)
+{
+	char *end;
+
+	if (*p++ != '/')
+		return NULL;
+
+	while (*p > ' ' && *p != '@' && *p != '/')
+		p++;
+	if (*p != '@')
+		return NULL;
+
+	*unit = strtoul(p + 1, &end, 16);
+	*fn = 0;
+	if (*end == ',')
+		*fn = strtoul(end + 1, &end, 16);
+
+	while (*end > ' ' && *end != '/')
+		end++;
+
+	return end;
+}
+
+enum boot_path_state scan_boot_path(const char *path)
+{
+	const char *p;
+	pcidev_t dev = 0;
+	u32 unit, fn, bus = 0, class;
+	int have_dev = 0, have_port = 0;
+
+	if (strncmp(path, PCI_ROOT, strlen(PCI_ROOT)))
+		return BOOT_PATH_UNKNOWN;
+
+	// PCI functions down to the first one that is not a bridge
+	for (p = path + strlen(PCI_ROOT); *p == '/'; ) {
+		p = parse_component(p, &unit, &fn);
+		if (!p)
+			return BOOT_PATH_UNKNOWN;
+
+		if (have_dev) {
+			if ((pci_read_config8(dev, CFG_HEADER_TYPE) & 0x7f) !=
+			    CFG_HEADER_BRIDGE) {
+				have_port = 1;
+				break;
+			}
+			bus = pci_read_config8(dev, CFG_SECONDARY_BUS);
+			if (!bus)
+				return BOOT_PATH_UNKNOWN;
+		}
+
+		if (unit > 0x1f || fn > 7)
+			return BOOT_PATH_UNKNOWN;
+
+		dev = PCI_DEV(bus, unit, fn);
+		have_dev = 1;
+
+		if (pci_read_config16(dev, CFG_VENDOR_ID) == 0xffff)
+			return BOOT_PATH_ABSENT;
+	}
+
+	if (!have_dev)
+		return BOOT_PATH_UNKNOWN;
+
+	class = pci_read_config32(dev, CFG_CLASS_REVISION) >> 8;
+
+	if (class >> 8 == PCI_CLASS_SDHCI)
+		return sdhci_card_state(dev);
+
+	if (!have_port)
+		return BOOT_PATH_PRESENT;
+
+	switch (class) {
+	case PCI_CLASS_AHCI:
+		return ahci_port_state(dev, unit);
+	case PCI_CLASS_EHCI:
+	case PCI_CLASS_XHCI:
+		return usb_port_state(dev, class, unit);
+	}
+
+	return BOOT_PATH_PRESENT;
+}
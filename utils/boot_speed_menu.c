@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <cbfs.h>
+#include <curses.h>
+#include <boot_speed_menu.h>
+#include <cbfs_edit.h>
+
+/* SeaBIOS runtime config files, integers stored little endian */
+struct boot_knob {
+	char cmd;
+	const char *file;
+	const char *desc;
+	int hex;
+};
+
+static const struct boot_knob knobs[] = {
+	{ 'm', "etc/boot-menu-wait", "Boot menu wait in ms", 0 },
+	{ 'u', "etc/usb-time-sigatt", "USB attach wait in ms", 0 },
+	{ 's', "etc/sercon-port", "Serial console I/O port, 0 disables", 1 },
+	{ 'o', "etc/pci-optionrom-exec",
+	  "PCI option ROMs, 0 none, 1 VGA only, 2 all", 0 },
+};
+
+#define KNOBS	ARRAY_SIZE(knobs)
+
+static size_t knob_size[KNOBS];	// 0 if the file is not in CBFS
+static u64 knob_value[KNOBS];
+static u8 knob_changed[KNOBS];
+
+static void load_knobs(void)
+{
+	u8 *data;
+	size_t size;
+	int i, j;
+
+	for (i = 0; i < KNOBS; i++) {
+		knob_size[i] = 0;
+		knob_value[i] = 0;
+		knob_changed[i] = 0;
+
+		data = cbfs_map(knobs[i].file, &size);
+		if (!data)
+			continue;
+
+		if (size && size <= sizeof(u64)) {
+			for (j = size - 1; j >= 0; j--)
+				knob_value[i] = (knob_value[i] << 8) | data[j];
+			knob_size[i] = size;
+		}
+		cbfs_unmap(data);
+	}
+}
+
+static void print_boot_speed_menu(void)
+{
+	int i;
+
+	printf("\n\n--- Boot speed menu ---\n");
+	for (i = 0; i < KNOBS; i++) {
+		printf("  %c value - %s\n", knobs[i].cmd, knobs[i].desc);
+		if (!knob_size[i])
+			printf("            %s not in CBFS\n", knobs[i].file);
+		else if (knobs[i].hex)
+			printf("            Currently 0x%llx%s\n", knob_value[i],
+			       knob_changed[i] ? " (changed)" : "");
+		else
+			printf("            Currently %llu%s\n", knob_value[i],
+			       knob_changed[i] ? " (changed)" : "");
+	}
+	printf("  w - Write and exit\n");
+	printf("  x - Exit without writing\n");
+	printf("\n");
+}
+
+static void handle_knob_command(int i, char *command)
+{
+	u64 value;
+	char *end;
+
+	if (!knob_size[i]) {
+		printf("%s not in CBFS, it can't be added here\n",
+		       knobs[i].file);
+		return;
+	}
+
+	value = strtoull(command + 1, &end, knobs[i].hex ? 16 : 10);
+	if (end == command + 1) {
+		printf("Please enter a value\n");
+		return;
+	}
+
+	if (knob_size[i] < sizeof(u64) && value >> (knob_size[i] * 8)) {
+		printf("Value doesn't fit in %zu bytes\n", knob_size[i]);
+		return;
+	}
+
+	knob_value[i] = value;
+	knob_changed[i] = 1;
+}
+
+static void write_knobs(void)
+{
+	u8 buf[sizeof(u64)];
+	int i, j;
+
+	for (i = 0; i < KNOBS; i++) {
+		if (!knob_changed[i])
+			continue;
+
+		for (j = 0; j < knob_size[i]; j++)
+			buf[j] = knob_value[i] >> (j * 8);
+
+		printf("Writing %s\n", knobs[i].file);
+		if (cbfs_rewrite_file(knobs[i].file, buf, knob_size[i])) {
+			printf("Writing %s failed\n", knobs[i].file);
+			return;
+		}
+		knob_changed[i] = 0;
+	}
+}
+
+void handle_boot_speed_menu(void)
+{
+	bool end = FALSE;
+	char *command;
+	int i;
+
+	load_knobs();
+
+	while(1) {
+		print_boot_speed_menu();
+		command = readline("> ");
+
+		for (i = 0; i < KNOBS; i++) {
+			if (command[0] == knobs[i].cmd)
+				break;
+		}
+
+		if (i < KNOBS) {
+			handle_knob_command(i, command);
+		} else {
+			switch(command[0]) {
+			case 'w':
+				write_knobs();
+				__attribute__((fallthrough));
+			case 'x':
+				end = TRUE;
+				break;
+			default:
+				printf("wrong command: '%s'\n", command);
+				break;
+			}
+		}
+
+		command[0] = '\0';
+
+		if (end)
+			break;
+	}
+}
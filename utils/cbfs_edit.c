@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <boot_device.h>
+#include <cbfs.h>
+#include <cbfs_edit.h>
+#include <flash_access.h>
+
+#define CBFS_FILE_MAGIC		"LARCHIVE"
+#define CBFS_ALIGNMENT		64
+#define CBFS_ATTR_COMPRESSION	0x42435a4c
+#define CBFS_NAME_MAX		64
+
+/* File header as stored in CBFS, big endian */
+struct cbfs_file_header {
+	char magic[8];
+	u32 len;
+	u32 type;
+	u32 attributes_offset;
+	u32 offset;
+	char filename[CBFS_NAME_MAX];
+} __attribute__((packed));
+
+struct cbfs_file_attr {
+	u32 tag;
+	u32 len;
+	u32 compression;
+} __attribute__((packed));
+
+#ifndef COREBOOT_LEGACY
+static int cbfs_is_compressed(size_t file, const struct cbfs_file_header *h)
+{
+	struct cbfs_file_attr attr;
+	u32 pos = be32toh(h->attributes_offset);
+	u32 end = be32toh(h->offset);
+
+	while (pos && pos + sizeof(attr) <= end) {
+		if (boot_device_read(&attr, file + pos, sizeof(attr)) !=
+		    sizeof(attr))
+			return -1;
+		if (be32toh(attr.len) < 8)
+			return -1;
+		if (be32toh(attr.tag) == CBFS_ATTR_COMPRESSION)
+			return !!attr.compression;
+		pos += be32toh(attr.len);
+	}
+
+	return 0;
+}
+
+int cbfs_locate_raw(const char *name, u32 *address, size_t *size)
+{
+	struct cbfs_file_header h;
+	size_t cbfs, cbfs_size, pos;
+	u32 rom_begin = (0xFFFFFFFF - lib_sysinfo.spi_flash.size) + 1;
+	u32 hdr_len = offsetof(struct cbfs_file_header, filename);
+
+	if (fmap_locate_area("COREBOOT", &cbfs, &cbfs_size))
+		return -1;
+
+	for (pos = 0; pos + sizeof(h) <= cbfs_size;) {
+		if (boot_device_read(&h, cbfs + pos, sizeof(h)) != sizeof(h))
+			return -1;
+		if (memcmp(h.magic, CBFS_FILE_MAGIC, sizeof(h.magic)))
+			break;
+
+		if (be32toh(h.offset) < hdr_len)
+			return -1;
+
+		if (!strncmp(h.filename, name, sizeof(h.filename))) {
+			if (cbfs_is_compressed(cbfs + pos, &h)) {
+				printf("%s is compressed, can't edit it\n",
+				       name);
+				return -1;
+			}
+			*address = rom_begin + cbfs + pos + be32toh(h.offset);
+			*size = be32toh(h.len);
+			return 0;
+		}
+
+		pos = ALIGN_UP(pos + be32toh(h.offset) + be32toh(h.len),
+			       CBFS_ALIGNMENT);
+	}
+
+	return -1;
+}
+#else
+int cbfs_locate_raw(const char *name, u32 *address, size_t *size)
+{
+	void *data = cbfs_get_file_content(CBFS_DEFAULT_MEDIA, name,
+					   CBFS_TYPE_RAW, size);
+
+	if (!data)
+		return -1;
+
+	*address = (u32)data;
+	return 0;
+}
+#endif
+
+int cbfs_rewrite_file(const char *name, const void *data, size_t len)
+{
+	u32 address;
+	size_t size;
+
+	if (cbfs_locate_raw(name, &address, &size)) {
+		printf("Error: file [%s] not found!\n", name);
+		return -1;
+	}
+
+	if (size != len) {
+		printf("%s is %zu bytes, not %zu\n", name, size, len);
+		return -1;
+	}
+
+	return flash_rewrite_range(address, data, len);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <crc32.h>
+
+#define CRC32_POLY	0xedb88320
+
+/* Slice-by-8: eight bytes per step, 8 KiB of tables built on first use */
+static u32 crc_table[8][256];
+static int crc_table_ready;
+
+static void crc32_init_table(void)
+{
+	u32 crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (-(crc & 1) & CRC32_POLY);
+		crc_table[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc_table[j][i] = (crc_table[j - 1][i] >> 8) ^
+				crc_table[0][crc_table[j - 1][i] & 0xff];
+
+	crc_table_ready = 1;
+}
+
+u32 crc32_update(u32 crc, const void *buf, size_t len)
+{
+	const u8 *p = buf;
+	u32 lo, hi;
+
+	if (!crc_table_ready)
+		crc32_init_table();
+
+	crc = ~crc;
+
+	while (len && ((uintptr_t)p & 3)) {
+		crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xff];
+		len--;
+	}
+
+	while (len >= 8) {
+		lo = *(const u32 *)p ^ crc;
+		hi = *(const u32 *)(p + 4);
+		crc = crc_table[7][lo & 0xff] ^
+		      crc_table[6][(lo >> 8) & 0xff] ^
+		      crc_table[5][(lo >> 16) & 0xff] ^
+		      crc_table[4][lo >> 24] ^
+		      crc_table[3][hi & 0xff] ^
+		      crc_table[2][(hi >> 8) & 0xff] ^
+		      crc_table[1][(hi >> 16) & 0xff] ^
+		      crc_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xff];
+
+	return ~crc;
+}
@@ -19,20 +19,67 @@
 
 #include <spi/spi_flash.h>
 #include <flash_access.h>
+#include <flash_queue.h>
+#include <crc32.h>
 #include <spi/spi_flash_internal.h>
 
 #define FLASH_SIZE_CHUNK   0x1000 //4k
+#define FLASH_SPEED_HZ     33000000
+#define VERIFY_CHUNK       256
+#define VERIFY_TRIES       3
 
 static struct spi_flash *flash_device;
 
+/* save_flash() and flash_rewrite_range() state, used by the queued steps */
+static char cbfs_formatted_list[MAX_DEVICES * MAX_LENGTH];
+static u8 rewrite_sector[FLASH_SIZE_CHUNK];
+static u8 save_wp_toggle;
+static int save_locked;		// protection found before the save
+static int save_lifted;		// protection covered the sector, got lifted
+static int save_temporary;	// protection lifted until next power cycle
+static int save_unlocked;
+static u32 save_address;
+static int save_len;
+static const void *save_data;	// what save_verify() compares against
+
+#ifdef BOOTORDER_AB
+#define BOOTORDER_SLOT_SIZE	FLASH_SIZE_CHUNK
+#define BOOTORDER_SLOT_MAGIC	0x42414f53	// "SOAB"
+
+// end of each slot, programmed after the bootorder data
+struct bootorder_trailer {
+	u32 magic;
+	u32 generation;
+};
+
+#define BOOTORDER_SLOT_DATA \
+	(BOOTORDER_SLOT_SIZE - sizeof(struct bootorder_trailer))
+
+static u32 ab_region;		// 0 if the region has a single slot
+static u32 ab_active;		// offset of the active slot in the region
+static int ab_spare_erased;
+static struct bootorder_trailer ab_trailer;	// of the next save
+#endif
+
 /*******************************************************************************/
 inline int init_flash(void)
 {
-	flash_device = spi_flash_probe(0, 0, 0, 0);
+	flash_device = spi_flash_probe(0, 0, FLASH_SPEED_HZ, SPI_MODE_0);
+	// QEMU has a CFI parallel flash instead
+	if (!flash_device)
+		flash_device = cfi_flash_probe();
 
 	if (!flash_device)
 		return -1;
 
+#ifndef COREBOOT_LEGACY
+	// coreboot only reports SPI flash, the ROM window base depends on it
+	if (!lib_sysinfo.spi_flash.size)
+		lib_sysinfo.spi_flash.size = flash_device->size;
+#endif
+
+	flash_queue_init(flash_device);
+
 	return 0;
 }
 
@@ -42,6 +89,16 @@ inline int is_flash_locked(void)
 	return spi_flash_is_locked(flash_device);
 }
 
+/*******************************************************************************/
+void flash_keep_writable(u32 address, u32 len)
+{
+	if (!flash_device)
+		return;
+
+	flash_device->wp_keep_offset = address & (flash_device->size - 1);
+	flash_device->wp_keep_len = len;
+}
+
 /*******************************************************************************/
 inline int lock_flash(void)
 {
@@ -54,6 +111,14 @@ inline int unlock_flash(void)
 	return spi_flash_unlock(flash_device);
 }
 
+int read_flash(u32 offset, void *buf, size_t len)
+{
+	if (!flash_device)
+		return -1;
+
+	return spi_flash_read(flash_device, offset, len, buf);
+}
+
 inline int read_sec_status(void)
 {
 	return spi_flash_sec_sts(flash_device);
@@ -88,75 +153,472 @@ inline int send_flash_cmd_write(u8 command, size_t cmd_len, const void *data,
 				size_t data_len)
 {
 	const u8 cmd = command;
+
+	// raw commands may change the status registers behind the cache
+	spi_flash_sr_invalidate(flash_device);
 	return spi_flash_cmd_write(flash_device->spi, &cmd, cmd_len, data,
 				   data_len);
 }
 
 /*******************************************************************************/
-void save_flash(u32 flash_address, char buffer[MAX_DEVICES][MAX_LENGTH],
-	        u8 max_lines, u8 spi_wp_toggle) {
-	int i = 0;
-	int k = 0;
-	int j, ret;
-	char cbfs_formatted_list[MAX_DEVICES * MAX_LENGTH];
-	u32 nvram_pos;
+int read_status_regs(u8 *sr1, u8 *sr2)
+{
+	if (spi_flash_read_sr(flash_device, 0, sr1))
+		return -1;
 
-	// compact the table into the expected packed list
-	for (j = 0; j < max_lines; j++) {
-		for (k = 0; k < MAX_LENGTH; k++) {
-			cbfs_formatted_list[i++] = buffer[j][k];
-			if (buffer[j][k] == NEWLINE )
-				break;
+	return spi_flash_read_sr(flash_device, 1, sr2);
+}
+
+/*******************************************************************************/
+int write_status_regs(u8 sr1, u8 sr2)
+{
+	const u8 status[2] = { sr1, sr2 };
+
+	return spi_flash_write_sr(flash_device, status, sizeof(status), 0);
+}
+
+/*******************************************************************************/
+int write_status_regs_volatile(u8 sr1, u8 sr2)
+{
+	const u8 status[2] = { sr1, sr2 };
+
+	// parts without volatile protection bits have no volatile unlock
+	if (!flash_device->unlock_volatile)
+		return -1;
+
+	return spi_flash_write_sr(flash_device, status, sizeof(status), 1);
+}
+
+/*******************************************************************************/
+int flash_bp_table(const struct spi_flash_bp **table, u8 mask[2])
+{
+	if (!flash_device || !flash_device->bp_table)
+		return 0;
+
+	*table = flash_device->bp_table;
+	mask[0] = flash_device->bp_mask[0];
+	mask[1] = flash_device->bp_mask[1];
+
+	return flash_device->bp_count;
+}
+
+/*******************************************************************************/
+const struct spi_flash_bp *flash_bp_lookup(u8 sr1, u8 sr2)
+{
+	return spi_flash_bp_lookup(flash_device, sr1, sr2);
+}
+
+/*******************************************************************************/
+void refresh_status_regs(void)
+{
+	spi_flash_sr_invalidate(flash_device);
+}
+
+/*******************************************************************************/
+int flash_session_begin(void)
+{
+	if (!flash_device->spi)
+		return 0;
+
+	flash_device->spi->rw = SPI_WRITE_FLAG;
+	return spi_claim_bus(flash_device->spi);
+}
+
+/*******************************************************************************/
+void flash_session_end(void)
+{
+	if (flash_device->spi)
+		spi_release_bus(flash_device->spi);
+}
+
+#ifdef BOOTORDER_AB
+/*******************************************************************************/
+int bootorder_ab_init(u32 region, u32 size)
+{
+	const struct bootorder_trailer *t;
+	u32 slot, generation = 0;
+	int found = 0;
+
+	if (size < 2 * BOOTORDER_SLOT_SIZE || region % BOOTORDER_SLOT_SIZE)
+		return -1;
+
+	ab_region = region;
+	ab_active = 0;
+
+	// a region without trailers holds the plain file in the first slot
+	for (slot = 0; slot < 2 * BOOTORDER_SLOT_SIZE;
+	     slot += BOOTORDER_SLOT_SIZE) {
+		t = (const void *)(uintptr_t)(region + slot +
+					      BOOTORDER_SLOT_DATA);
+		if (t->magic != BOOTORDER_SLOT_MAGIC)
+			continue;
+		if (!found || (s32)(t->generation - generation) > 0) {
+			ab_active = slot;
+			generation = t->generation;
+			found = 1;
 		}
 	}
-	cbfs_formatted_list[i++] = NUL;
 
-	// try to unlock the flash if it is locked
-	if (spi_flash_is_locked(flash_device)) {
+	ab_trailer.magic = BOOTORDER_SLOT_MAGIC;
+	ab_trailer.generation = generation + 1;
+
+	return ab_active;
+}
+
+/*******************************************************************************/
+static int bootorder_ab_erased(void)
+{
+	ab_spare_erased = 1;
+	return 0;
+}
+
+/*******************************************************************************/
+void bootorder_ab_prepare(void)
+{
+	u32 spare, buf[16];
+	int i, j;
+
+	if (!ab_region || !flash_device || ab_spare_erased)
+		return;
+
+	spare = ab_region + (ab_active ^ BOOTORDER_SLOT_SIZE);
+
+	for (i = 0; i < BOOTORDER_SLOT_SIZE; i += sizeof(buf)) {
+		if (spi_flash_read(flash_device, spare + i, sizeof(buf), buf))
+			return;
+		for (j = 0; j < ARRAY_SIZE(buf) && buf[j] == 0xffffffff; j++)
+			;
+		if (j < ARRAY_SIZE(buf))
+			break;
+	}
+
+	if (i == BOOTORDER_SLOT_SIZE) {
+		ab_spare_erased = 1;
+		return;
+	}
+
+	// write protection is only lifted when the user actually saves, the
+	// lock layout normally leaves the bootorder region writable though
+	if (!spi_flash_is_writable(flash_device, spare, BOOTORDER_SLOT_SIZE))
+		return;
+
+	// runs from flash_queue_poll() while the menu waits for a key
+	if (!flash_queue_erase(spare, BOOTORDER_SLOT_SIZE))
+		flash_queue_call(bootorder_ab_erased, 0);
+}
+#endif
+
+/*******************************************************************************/
+static int flash_crc32(u32 address, size_t len, u32 *crc)
+{
+	u8 buf[VERIFY_CHUNK];
+	size_t chunk;
+
+	*crc = 0;
+	for (; len; address += chunk, len -= chunk) {
+		chunk = MIN(len, sizeof(buf));
+		if (spi_flash_read(flash_device, address, chunk, buf))
+			return -1;
+		*crc = crc32_update(*crc, buf, chunk);
+	}
+
+	return 0;
+}
+
+/*******************************************************************************/
+/*
+ * Compare the programmed range with data by CRC and program the pages that
+ * differ again. Bits that must go back to 1 need an erase, which is only
+ * done if the range starts a sector of its own.
+ */
+static int verify_flash(u32 address, size_t len, const void *data)
+{
+	const u8 *src = data;
+	u8 buf[VERIFY_CHUNK];
+	u32 crc, expected, pos;
+	size_t page, chunk, i;
+	int tries, erase;
+
+	page = MIN(flash_device->page_size ? flash_device->page_size : 256,
+		   VERIFY_CHUNK);
+	expected = crc32_update(0, data, len);
+
+	for (tries = 0; tries < VERIFY_TRIES; tries++) {
+		if (flash_crc32(address, len, &crc))
+			return -1;
+		if (crc == expected)
+			return 0;
+
+		printf("Verify failed (crc 0x%08x, expected 0x%08x), rewriting\n",
+		       crc, expected);
+
+		erase = 0;
+		for (pos = 0; pos < len && !erase; pos += chunk) {
+			chunk = MIN(page - (address + pos) % page, len - pos);
+			if (spi_flash_read(flash_device, address + pos, chunk,
+					   buf))
+				return -1;
+			if (!memcmp(buf, src + pos, chunk))
+				continue;
+
+			for (i = 0; i < chunk; i++)
+				if (~buf[i] & src[pos + i])
+					erase = 1;
+
+			if (!erase && spi_flash_write(flash_device,
+						      address + pos, chunk,
+						      src + pos))
+				return -1;
+		}
+
+		if (!erase)
+			continue;
+
+		if (address % flash_device->sector_size ||
+		    len > flash_device->sector_size)
+			return -1;
+
+		if (spi_flash_erase(flash_device, address,
+				    flash_device->sector_size) ||
+		    spi_flash_write(flash_device, address, len, data))
+			return -1;
+	}
+
+	printf("Verify failed\n");
+	return -1;
+}
+
+/*******************************************************************************/
+static int save_verify(void)
+{
+	return verify_flash(save_address, save_len, save_data);
+}
+
+#ifdef BOOTORDER_AB
+/*******************************************************************************/
+static int save_verify_trailer(void)
+{
+	return verify_flash(save_address + BOOTORDER_SLOT_DATA,
+			    sizeof(ab_trailer), &ab_trailer);
+}
+#endif
+
+/*******************************************************************************/
+static int save_unlock(void)
+{
+	u32 sector = save_address & ~(flash_device->sector_size - 1);
+
+	save_temporary = 0;
+	save_lifted = 0;
+	save_locked = spi_flash_is_locked(flash_device);
+
+	// try to unlock the flash if the sector is protected, preferably only
+	// until the next power cycle so the non-volatile protection is left
+	// untouched; the lock layout normally leaves the bootorder writable
+	if (!spi_flash_is_writable(flash_device, sector,
+				   flash_device->sector_size)) {
 		printf("Flash is locked, trying to unlock...\n");
-		spi_flash_unlock(flash_device);
-		if (spi_flash_is_locked(flash_device)) {
+		save_lifted = 1;
+		save_temporary = !spi_flash_unlock_volatile(flash_device);
+		if (!save_temporary)
+			spi_flash_unlock(flash_device);
+		if (!spi_flash_is_writable(flash_device, sector,
+					   flash_device->sector_size)) {
 			printf("Flash is write protected. Exiting...\n");
-			return;
+			return -1;
 		} else {
 			printf("Flash unlocked successfully.\n");
 		}
 	}
 
+	save_unlocked = 1;
+	return 0;
+}
+
+/*******************************************************************************/
+static int save_protect(void)
+{
+	u32 sector = save_address & ~(flash_device->sector_size - 1);
+
+	if (!save_unlocked)
+		return 0;
+
+	if (save_wp_toggle) {
+		// still in place if the sector was writable anyway
+		if (save_locked && !save_lifted)
+			return 0;
+		printf("Enabling flash write protect...\n");
+		// non-volatile bits are still set after a temporary unlock,
+		// they are rewritten once if the lock layout would have left
+		// the sector writable, so later saves need no unlock
+		if (!save_temporary || spi_flash_lock_volatile(flash_device) ||
+		    spi_flash_is_writable(flash_device, sector,
+					  flash_device->sector_size))
+			spi_flash_lock(flash_device);
+	} else if (save_temporary || (save_locked && !save_lifted)) {
+		// write protect got disabled in the menu, make it persistent
+		spi_flash_unlock(flash_device);
+	}
+
+	return 0;
+}
+
+/*******************************************************************************/
+static int save_queue(u32 flash_address, int len)
+{
+#ifdef BOOTORDER_AB
+	if (ab_region) {
+		if (len > BOOTORDER_SLOT_DATA) {
+			printf("Bootorder does not fit in a slot\n");
+			return -1;
+		}
+
+		// the old slot stays valid until the trailer is programmed
+		flash_address = ab_region + (ab_active ^ BOOTORDER_SLOT_SIZE);
+		if (!ab_spare_erased) {
+			printf("Erasing Flash size 0x%x @ 0x%x\n",
+			       BOOTORDER_SLOT_SIZE, flash_address);
+			if (flash_queue_erase(flash_address,
+					      BOOTORDER_SLOT_SIZE))
+				return -1;
+		}
+		ab_spare_erased = 0;
+
+		save_address = flash_address;
+		save_len = len;
+		save_data = cbfs_formatted_list;
+
+		// a slot that fails to verify never gets its trailer
+		printf("Writing %d bytes @ 0x%x, generation %u\n", len,
+		       flash_address, ab_trailer.generation);
+		return flash_queue_program(flash_address, len,
+					   cbfs_formatted_list) ||
+		       flash_queue_call(save_verify, 0) ||
+		       flash_queue_program(flash_address + BOOTORDER_SLOT_DATA,
+					   sizeof(ab_trailer), &ab_trailer) ||
+		       flash_queue_call(save_verify_trailer, 0);
+	}
+#endif
+
+	save_address = flash_address;
+	save_len = len;
+	save_data = cbfs_formatted_list;
+
 	printf("Erasing Flash size 0x%x @ 0x%x\n",
 	       FLASH_SIZE_CHUNK, flash_address);
-	ret = spi_flash_erase(flash_device, flash_address, FLASH_SIZE_CHUNK);
-	if (ret) {
-		printf("Erase failed, ret: %d\n", ret);
-		return;
-	}
+	printf("Writing %d bytes @ 0x%x\n", len, flash_address);
 
-	printf("Writing %d bytes @ 0x%x\n", i, flash_address);
-	// write first 512 bytes
-	for (nvram_pos = 0; nvram_pos < (i & 0xFFFC); nvram_pos += 4) {
-		ret = spi_flash_write(flash_device, nvram_pos + flash_address,
-				      sizeof(u32),
-				      (u32 *)(cbfs_formatted_list + nvram_pos));
-		if (ret) {
-			printf("Write failed, ret: %d\n", ret);
-			return;
+	return flash_queue_erase(flash_address, FLASH_SIZE_CHUNK) ||
+	       flash_queue_program(flash_address, len, cbfs_formatted_list) ||
+	       flash_queue_call(save_verify, 0);
+}
+
+/*******************************************************************************/
+int save_flash(u32 flash_address, char buffer[MAX_DEVICES][MAX_LENGTH],
+	       u8 max_lines, u8 spi_wp_toggle) {
+	int i = 0;
+	int k = 0;
+	int j, ret;
+
+	// compact the table into the expected packed list
+	for (j = 0; j < max_lines; j++) {
+		for (k = 0; k < MAX_LENGTH; k++) {
+			cbfs_formatted_list[i++] = buffer[j][k];
+			if (buffer[j][k] == NEWLINE )
+				break;
 		}
 	}
-	// write remaining filler characters in one run
-	ret = spi_flash_write(flash_device, nvram_pos + flash_address,
-			      sizeof(i % 4),
-			      (u32 *)(cbfs_formatted_list + nvram_pos));
-	if (ret) {
-		printf("Write failed, ret: %d\n", ret);
-		return;
+	cbfs_formatted_list[i++] = NUL;
+
+	save_wp_toggle = spi_wp_toggle;
+	save_unlocked = 0;
+
+	// protection is restored even if the user cancels in between
+	if (flash_queue_call(save_unlock, 0) ||
+	    save_queue(flash_address, i) ||
+	    flash_queue_call(save_protect, FLASH_JOB_ALWAYS)) {
+		printf("Unable to queue flash update\n");
+		flash_queue_cancel();
+		flash_queue_run();
+		return -1;
 	}
 
-	if (spi_wp_toggle) {
-		printf("Enabling flash write protect...\n");
-		spi_flash_lock(flash_device);
+	printf("Press c to cancel\n");
+	ret = flash_queue_run();
+	if (ret == FLASH_QUEUE_CANCELLED) {
+		printf("Cancelled, settings not saved\n");
+		return ret;
+	} else if (ret) {
+		printf("Save failed, ret: %d\n", ret);
+		return ret;
 	}
 
-	spi_wp_toggle = spi_flash_is_locked(flash_device);
+#ifdef BOOTORDER_AB
+	if (ab_region) {
+		ab_active ^= BOOTORDER_SLOT_SIZE;
+		ab_trailer.generation++;
+	}
+#endif
 
 	printf("Done\n");
+	return 0;
+}
+
+/*******************************************************************************/
+int flash_rewrite_range(u32 address, const void *data, size_t len)
+{
+	const u8 *src = data;
+	u32 sector, sector_size;
+	size_t pos, chunk;
+	int ret;
+
+	if (!flash_device)
+		return -1;
+
+	sector_size = flash_device->sector_size;
+	if (sector_size > sizeof(rewrite_sector))
+		return -1;
+
+	// rewrite_sector is ours only once the queue is idle
+	flash_queue_wait();
+
+	for (; len; address += chunk, src += chunk, len -= chunk) {
+		sector = address & ~(sector_size - 1);
+		pos = address - sector;
+		chunk = MIN(len, sector_size - pos);
+
+		if (spi_flash_read(flash_device, sector, sector_size,
+				   rewrite_sector))
+			return -1;
+		if (!memcmp(rewrite_sector + pos, src, chunk))
+			continue;
+		memcpy(rewrite_sector + pos, src, chunk);
+
+		// leave the protection as it was found
+		save_wp_toggle = spi_flash_is_locked(flash_device);
+		save_unlocked = 0;
+		save_address = sector;
+		save_len = sector_size;
+		save_data = rewrite_sector;
+
+		printf("Rewriting sector @ 0x%x\n", sector);
+		if (flash_queue_call(save_unlock, 0) ||
+		    flash_queue_erase(sector, sector_size) ||
+		    flash_queue_program(sector, sector_size, rewrite_sector) ||
+		    flash_queue_call(save_verify, 0) ||
+		    flash_queue_call(save_protect, FLASH_JOB_ALWAYS)) {
+			printf("Unable to queue flash update\n");
+			flash_queue_cancel();
+			flash_queue_wait();
+			return -1;
+		}
+
+		// the sectors are shared with the rest of CBFS, a stray key
+		// must not leave one of them erased or a file half written
+		ret = flash_queue_wait();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
 }
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <crc32.h>
+#include <flash_access.h>
+#include <flash_dump.h>
+
+/*
+ * Protocol, all on the serial port, the other consoles only get the prompt:
+ *     SBODUMP <version> <flash size> <block size>\n   greeting
+ *     G <block>\n     stream the frames from block on, then the end frame
+ *     Q\n             back to the menu
+ * Other lines bring back the greeting.
+ * Any byte from the host stops a stream after the current frame, so the
+ * host resumes after an error with a new G command. Each frame is a struct
+ * dump_frame followed by len payload bytes.
+ */
+#define DUMP_VERSION		1
+#define DUMP_BLOCK_SIZE		4096
+#define DUMP_FRAME_MAGIC	0xa5
+/* Back to the menu if no command comes in for that long */
+#define DUMP_IDLE_US		60000000
+
+enum dump_frame_type {
+	DUMP_RAW,	/* block as is */
+	DUMP_RLE,	/* see dump_rle() */
+	DUMP_FILL,	/* one byte repeated over the block */
+	DUMP_END,	/* block is the block count, no payload */
+};
+
+struct dump_frame {
+	u8 magic;
+	u8 type;
+	u16 len;
+	u32 block;
+	u32 crc;	/* CRC32 of the block as read from flash */
+} __attribute__((packed));
+
+static u8 block_buf[DUMP_BLOCK_SIZE];
+static u8 rle_buf[DUMP_BLOCK_SIZE];
+
+/* Binary data bypasses printf, no newline translation, no video console */
+static void dump_write(const void *buf, size_t len)
+{
+	const u8 *p = buf;
+
+	while (len--)
+		serial_putchar(*p++);
+}
+
+static int dump_read_line(char *line, int size)
+{
+	u64 start = timer_us(0);
+	int len = 0;
+	int c;
+
+	while (timer_us(start) < DUMP_IDLE_US) {
+		if (!serial_havechar())
+			continue;
+
+		c = serial_getchar();
+		if (c == '\r' || c == '\n') {
+			if (len) {
+				line[len] = '\0';
+				return 0;
+			}
+			continue;
+		}
+		if (len < size - 1)
+			line[len++] = c;
+	}
+
+	return -1;
+}
+
+/*
+ * PackBits style: a control byte n below 128 is followed by n + 1 literal
+ * bytes, from 128 on by one byte repeated n - 125 times. Returns the
+ * encoded length or 0 if it doesn't fit in max.
+ */
+static size_t dump_rle(const u8 *src, size_t len, u8 *dst, size_t max)
+{
+	size_t in = 0, out = 0;
+	size_t run, lit;
+
+	while (in < len) {
+		for (run = 1; in + run < len && run < 130; run++)
+			if (src[in + run] != src[in])
+				break;
+
+		if (run >= 3) {
+			if (out + 2 > max)
+				return 0;
+			dst[out++] = run + 125;
+			dst[out++] = src[in];
+			in += run;
+			continue;
+		}
+
+		/* Literals up to the next run worth encoding */
+		for (lit = 1; in + lit < len && lit < 128; lit++)
+			if (in + lit + 2 < len &&
+			    src[in + lit] == src[in + lit + 1] &&
+			    src[in + lit] == src[in + lit + 2])
+				break;
+
+		if (out + 1 + lit > max)
+			return 0;
+		dst[out++] = lit - 1;
+		memcpy(dst + out, src + in, lit);
+		out += lit;
+		in += lit;
+	}
+
+	return out;
+}
+
+static int dump_block(u32 block)
+{
+	struct dump_frame frame;
+	const void *payload = block_buf;
+	size_t i;
+
+	/* The driver refreshes the ROM window after this session's writes */
+	if (read_flash(block * DUMP_BLOCK_SIZE, block_buf, DUMP_BLOCK_SIZE))
+		return -1;
+
+	frame.magic = DUMP_FRAME_MAGIC;
+	frame.block = block;
+	frame.crc = crc32_update(0, block_buf, DUMP_BLOCK_SIZE);
+
+	for (i = 1; i < DUMP_BLOCK_SIZE; i++)
+		if (block_buf[i] != block_buf[0])
+			break;
+
+	if (i == DUMP_BLOCK_SIZE) {
+		frame.type = DUMP_FILL;
+		frame.len = 1;
+	} else {
+		frame.len = dump_rle(block_buf, DUMP_BLOCK_SIZE, rle_buf,
+				     DUMP_BLOCK_SIZE - 1);
+		if (frame.len) {
+			frame.type = DUMP_RLE;
+			payload = rle_buf;
+		} else {
+			frame.type = DUMP_RAW;
+			frame.len = DUMP_BLOCK_SIZE;
+		}
+	}
+
+	dump_write(&frame, sizeof(frame));
+	dump_write(payload, frame.len);
+
+	return 0;
+}
+
+static void dump_stream(u32 block, u32 blocks)
+{
+	struct dump_frame frame = {
+		.magic = DUMP_FRAME_MAGIC,
+		.type = DUMP_END,
+		.block = blocks,
+	};
+
+	for (; block < blocks; block++) {
+		/* Left in the buffer, it starts the next command */
+		if (serial_havechar())
+			return;
+		/* No frame, the host times out and asks again */
+		if (dump_block(block))
+			return;
+	}
+
+	dump_write(&frame, sizeof(frame));
+}
+
+void flash_dump(void)
+{
+	char greeting[32], line[32];
+	u32 size = lib_sysinfo.spi_flash.size;
+	u32 blocks = size / DUMP_BLOCK_SIZE;
+	char *end;
+	u32 block;
+	int len;
+
+	if (!blocks) {
+		printf("Flash size unknown, can't dump\n");
+		return;
+	}
+
+	printf("Flash dump, run flash_dump_recv.py on the host or type Q\n");
+
+	len = snprintf(greeting, sizeof(greeting), "SBODUMP %d %u %d\n",
+		       DUMP_VERSION, size, DUMP_BLOCK_SIZE);
+	dump_write(greeting, len);
+
+	while (!dump_read_line(line, sizeof(line))) {
+		if (line[0] == 'Q' || line[0] == 'q')
+			break;
+
+		block = strtoul(line + 1, &end, 10);
+		if (line[0] == 'G' && end != line + 1 && !*end &&
+		    block <= blocks)
+			dump_stream(block, blocks);
+		else
+			dump_write(greeting, len);
+	}
+
+	printf("\nFlash dump finished\n");
+}
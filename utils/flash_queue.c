@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <flash_access.h>
+#include <flash_queue.h>
+#include <spi/spi_flash.h>
+#include <spi/spi_flash_internal.h>
+
+#define FLASH_QUEUE_LEN		16
+/* Longer than any sector erase or page program takes */
+#define FLASH_OP_TIMEOUT_US	5000000
+
+enum flash_job_type {
+	FLASH_JOB_ERASE,
+	FLASH_JOB_PROGRAM,
+	FLASH_JOB_CALL,
+};
+
+struct flash_job {
+	enum flash_job_type type;
+	u8 flags;
+	u32 offset;
+	size_t len;
+	const u8 *buf;
+	int (*fn)(void);
+};
+
+static struct spi_flash *flash;
+static struct flash_job jobs[FLASH_QUEUE_LEN];
+static unsigned int head, tail;
+static size_t job_pos;		/* bytes of the current job issued */
+static size_t in_flight;	/* bytes the chip is still busy with */
+static u64 op_start;
+static int status;		/* cancel or first error of this run */
+static int committed;		/* an erase or program was issued */
+static int session;
+static u32 bytes_done, bytes_total;
+
+void flash_queue_init(struct spi_flash *dev)
+{
+	flash = dev;
+}
+
+static struct flash_job *flash_queue_add(enum flash_job_type type, u8 flags)
+{
+	struct flash_job *job;
+
+	if (!flash || tail - head == FLASH_QUEUE_LEN)
+		return NULL;
+
+	/* First job of a new run */
+	if (head == tail) {
+		status = 0;
+		committed = 0;
+		bytes_done = 0;
+		bytes_total = 0;
+	}
+
+	job = &jobs[tail++ % FLASH_QUEUE_LEN];
+	memset(job, 0, sizeof(*job));
+	job->type = type;
+	job->flags = flags;
+
+	return job;
+}
+
+int flash_queue_erase(u32 offset, size_t len)
+{
+	struct flash_job *job;
+
+	if (!flash || offset % flash->sector_size || len % flash->sector_size)
+		return -1;
+
+	job = flash_queue_add(FLASH_JOB_ERASE, 0);
+	if (!job)
+		return -1;
+
+	job->offset = offset;
+	job->len = len;
+	bytes_total += len;
+
+	return 0;
+}
+
+int flash_queue_program(u32 offset, size_t len, const void *buf)
+{
+	struct flash_job *job = flash_queue_add(FLASH_JOB_PROGRAM, 0);
+
+	if (!job)
+		return -1;
+
+	job->offset = offset;
+	job->len = len;
+	job->buf = buf;
+	bytes_total += len;
+
+	return 0;
+}
+
+int flash_queue_call(int (*fn)(void), u8 flags)
+{
+	struct flash_job *job = flash_queue_add(FLASH_JOB_CALL, flags);
+
+	if (!job)
+		return -1;
+
+	job->fn = fn;
+	job->len = 1;
+
+	return 0;
+}
+
+static int flash_queue_started(size_t len)
+{
+	in_flight = len;
+	job_pos += len;
+	op_start = timer_us(0);
+
+	return 0;
+}
+
+static int flash_queue_blocking(int ret, size_t len)
+{
+	if (ret)
+		return ret;
+
+	job_pos += len;
+	bytes_done += len;
+
+	return 0;
+}
+
+static int flash_queue_issue(struct flash_job *job)
+{
+	u32 offset = job->offset + job_pos;
+	size_t left = job->len - job_pos;
+	int ret;
+
+	if (job->type != FLASH_JOB_CALL)
+		committed = 1;
+
+	switch (job->type) {
+	case FLASH_JOB_ERASE:
+		if (!flash->erase_cmd)
+			return flash_queue_blocking(
+				spi_flash_erase(flash, offset, left), left);
+
+		ret = spi_flash_start_erase(flash, offset);
+		if (ret)
+			return ret;
+
+		return flash_queue_started(flash->sector_size);
+	case FLASH_JOB_PROGRAM:
+		/* SST AAI parts have no page program to split on */
+		if (!flash->program_cmd)
+			return flash_queue_blocking(
+				spi_flash_write(flash, offset, left,
+						job->buf + job_pos), left);
+
+		ret = spi_flash_start_program(flash, offset, left,
+					      job->buf + job_pos);
+		if (ret < 0)
+			return ret;
+
+		return flash_queue_started(ret);
+	case FLASH_JOB_CALL:
+		job_pos = job->len;
+		return job->fn();
+	}
+
+	return -1;
+}
+
+int flash_queue_poll(void)
+{
+	struct flash_job *job;
+	int ret;
+
+	if (head == tail)
+		return 0;
+
+	if (in_flight) {
+		ret = spi_flash_is_busy(flash);
+		if (ret > 0 && timer_us(op_start) < FLASH_OP_TIMEOUT_US)
+			return 1;
+
+		if (ret) {
+			printf("Flash operation %s\n",
+			       ret > 0 ? "timed out" : "failed");
+			status = -1;
+		}
+
+		bytes_done += in_flight;
+		in_flight = 0;
+	}
+
+	/* Retire the jobs issued completely */
+	while (head != tail && job_pos >= jobs[head % FLASH_QUEUE_LEN].len) {
+		head++;
+		job_pos = 0;
+	}
+
+	if (head == tail) {
+		if (session)
+			flash_session_end();
+		session = 0;
+		return 0;
+	}
+
+	/* One bus claim for the whole run, driver claims nest inside */
+	if (!session && !flash_session_begin())
+		session = 1;
+
+	job = &jobs[head % FLASH_QUEUE_LEN];
+
+	if (status && !(job->flags & FLASH_JOB_ALWAYS)) {
+		job_pos = job->len;
+		return 1;
+	}
+
+	ret = flash_queue_issue(job);
+	if (ret) {
+		if (!status)
+			status = ret < 0 ? ret : -1;
+		job_pos = job->len;
+	}
+
+	return 1;
+}
+
+int flash_queue_busy(void)
+{
+	return head != tail;
+}
+
+void flash_queue_cancel(void)
+{
+	if (head != tail && !status && !committed)
+		status = FLASH_QUEUE_CANCELLED;
+}
+
+void flash_queue_progress(u32 *done, u32 *total)
+{
+	*done = bytes_done;
+	*total = bytes_total;
+}
+
+static int flash_queue_drain(int cancellable)
+{
+	u32 done, total, shown = ~0;
+	int key;
+
+	while (flash_queue_poll()) {
+		if (cancellable && havechar()) {
+			key = getchar();
+			if ((key == 'c' || key == 'C') && !status) {
+				flash_queue_cancel();
+				printf(status ? "\nCancelling...\n" :
+				       "\nFlash already erased, finishing\n");
+			}
+		}
+
+		flash_queue_progress(&done, &total);
+		if (total && done != shown) {
+			printf("\r%3u%%", done * 100 / total);
+			shown = done;
+		}
+	}
+
+	if (shown != ~0)
+		printf("\n");
+
+	return status;
+}
+
+int flash_queue_run(void)
+{
+	return flash_queue_drain(1);
+}
+
+int flash_queue_wait(void)
+{
+	return flash_queue_drain(0);
+}
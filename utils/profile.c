@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <profile.h>
+
+#define PROFILE_MARKS		24
+/* coreboot's timestamp for jumping to the payload */
+#define TS_SELFBOOT_JUMP	99
+
+/* As coreboot exports it, stamps are relative to base_time */
+struct timestamp_entry {
+	u32 entry_id;
+	s64 entry_stamp;
+} __attribute__((packed));
+
+struct timestamp_table {
+	u64 base_time;
+	u16 max_entries;
+	u16 tick_freq_mhz;
+	u32 num_entries;
+	struct timestamp_entry entries[0];
+} __attribute__((packed));
+
+static struct {
+	const char *name;
+	u64 tsc;
+} marks[PROFILE_MARKS];
+static int mark_count;
+
+void profile_mark(const char *name)
+{
+	if (mark_count == PROFILE_MARKS)
+		return;
+
+	marks[mark_count].name = name;
+	marks[mark_count++].tsc = timer_raw_value();
+}
+
+void profile_print(void)
+{
+	const struct timestamp_table *ts = lib_sysinfo.tstamp_table;
+	u64 base = 0, prev, mhz = timer_hz() / 1000000;
+	int i;
+
+	if (!mark_count || !mhz)
+		return;
+
+	prev = marks[0].tsc;
+
+	if (ts) {
+		base = ts->base_time;
+		if (ts->tick_freq_mhz)
+			mhz = ts->tick_freq_mhz;
+		for (i = 0; i < ts->num_entries; i++) {
+			if (ts->entries[i].entry_id == TS_SELFBOOT_JUMP)
+				prev = base + ts->entries[i].entry_stamp;
+		}
+		printf("Startup profile, us since coreboot started:\n");
+		if (prev != marks[0].tsc)
+			printf("  %-24s %9llu\n", "jump to payload",
+			       (prev - base) / mhz);
+	} else {
+		base = marks[0].tsc;
+		printf("Startup profile, us since payload entry:\n");
+	}
+
+	for (i = 0; i < mark_count; i++) {
+		printf("  %-24s %9llu %+9lld\n", marks[i].name,
+		       (marks[i].tsc - base) / mhz,
+		       (s64)(marks[i].tsc - prev) / (s64)mhz);
+		prev = marks[i].tsc;
+	}
+}
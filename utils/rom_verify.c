@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <cbfs_edit.h>
+#include <flash_access.h>
+#include <rom_verify.h>
+
+#define MANIFEST_LINE_LEN	128
+#define HASH_CHUNK		4096
+
+static const char *const result_names[] = {
+	[ROM_REGION_OK]		= "ok",
+	[ROM_REGION_MISMATCH]	= "MISMATCH",
+	[ROM_REGION_MISSING]	= "not in FMAP",
+	[ROM_REGION_INVALID]	= "bad manifest line",
+	[ROM_REGION_UNREADABLE]	= "read error",
+};
+
+/* Flash offsets of the manifest data, hashed as 0xff */
+static u32 manifest_start, manifest_end;
+
+static int hash_range(struct blake2s_state *s, u32 offset, u32 len)
+{
+	static u8 buf[HASH_CHUNK];
+	u32 n;
+
+	while (len) {
+		n = MIN(len, sizeof(buf));
+		if (offset >= manifest_start && offset < manifest_end) {
+			n = MIN(n, manifest_end - offset);
+			memset(buf, 0xff, n);
+		} else {
+			if (offset < manifest_start &&
+			    manifest_start - offset < n)
+				n = manifest_start - offset;
+			if (read_flash(offset, buf, n))
+				return -1;
+		}
+		blake2s_update(s, buf, n);
+		offset += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static int parse_digest(const char *hex, u8 *digest)
+{
+	int i, hi, lo;
+
+	for (i = 0; i < BLAKE2S_HASH_SIZE; i++) {
+		hi = hex_digit(hex[2 * i]);
+		lo = hi < 0 ? -1 : hex_digit(hex[2 * i + 1]);
+		if (lo < 0)
+			return -1;
+		digest[i] = hi << 4 | lo;
+	}
+
+	return hex[2 * i] ? -1 : 0;
+}
+
+static int region_locate(const char *name, u32 size, u32 *offset, u32 *len)
+{
+#ifndef COREBOOT_LEGACY
+	size_t area_offset, area_size;
+#endif
+
+	if (!strcmp(name, "*")) {
+		*offset = 0;
+		*len = size;
+		return 0;
+	}
+
+#ifndef COREBOOT_LEGACY
+	if (!fmap_locate_area(name, &area_offset, &area_size) &&
+	    area_offset <= size && area_size <= size - area_offset) {
+		*offset = area_offset;
+		*len = area_size;
+		return 0;
+	}
+#endif
+
+	return -1;
+}
+
+static int check_line(char *line, u32 size, rom_verify_report report)
+{
+	struct blake2s_state s;
+	u8 expected[BLAKE2S_HASH_SIZE], digest[BLAKE2S_HASH_SIZE];
+	char *name, *hex;
+	u32 offset, len;
+	int result;
+
+	name = strtok(line, " \t\r");
+	if (!name || name[0] == '#')
+		return 0;
+
+	hex = strtok(NULL, " \t\r");
+	memset(digest, 0, sizeof(digest));
+
+	if (!hex || parse_digest(hex, expected) || strtok(NULL, " \t\r")) {
+		result = ROM_REGION_INVALID;
+	} else if (region_locate(name, size, &offset, &len)) {
+		result = ROM_REGION_MISSING;
+	} else {
+		blake2s_init(&s);
+		if (hash_range(&s, offset, len)) {
+			result = ROM_REGION_UNREADABLE;
+		} else {
+			blake2s_final(&s, digest);
+			result = memcmp(digest, expected, sizeof(digest)) ?
+				 ROM_REGION_MISMATCH : ROM_REGION_OK;
+		}
+	}
+
+	report(name, result, digest);
+
+	return result != ROM_REGION_OK;
+}
+
+int rom_verify(rom_verify_report report)
+{
+	u32 size = lib_sysinfo.spi_flash.size;
+	u32 rom_begin = (0xFFFFFFFF - size) + 1;
+	char line[MANIFEST_LINE_LEN];
+	char text[64];
+	size_t text_len, pos, n = 0;
+	u32 address;
+	int failed = 0;
+	char c = '\0';
+
+	if (!size || cbfs_locate_raw(ROM_MANIFEST_FILE, &address, &text_len))
+		return -1;
+
+	manifest_start = address - rom_begin;
+	manifest_end = manifest_start + text_len;
+
+	/* The manifest may be padded with 0xff or NUL */
+	for (pos = 0; pos <= text_len; pos++) {
+		if (pos < text_len) {
+			if (pos % sizeof(text) == 0 &&
+			    read_flash(manifest_start + pos, text,
+				       MIN(sizeof(text), text_len - pos)))
+				return -1;
+			c = text[pos % sizeof(text)];
+		}
+
+		if (pos < text_len && c != '\n' && c != '\0' &&
+		    c != (char)0xff) {
+			if (n < sizeof(line) - 1)
+				line[n++] = c;
+			continue;
+		}
+
+		line[n] = '\0';
+		failed += check_line(line, size, report);
+		n = 0;
+
+		if (pos < text_len && c != '\n')
+			break;
+	}
+
+	return failed;
+}
+
+static void print_region(const char *region, int result, const u8 *digest)
+{
+	int i;
+
+	printf("  %-20s %s\n", region, result_names[result]);
+	if (result != ROM_REGION_MISMATCH)
+		return;
+
+	printf("    ");
+	for (i = 0; i < BLAKE2S_HASH_SIZE; i++)
+		printf("%02x", digest[i]);
+	printf("\n");
+}
+
+void handle_rom_verify(void)
+{
+	u64 start = timer_us(0);
+	int failed;
+
+	printf("Checking flash against %s (BLAKE2s, %s)\n", ROM_MANIFEST_FILE,
+	       blake2s_impl());
+
+	failed = rom_verify(print_region);
+	if (failed < 0) {
+		printf("No %s in CBFS\n", ROM_MANIFEST_FILE);
+		return;
+	}
+
+	printf("%s, %llu ms\n", failed ? "Flash differs from the manifest" :
+	       "Flash matches the manifest", timer_us(start) / 1000);
+}
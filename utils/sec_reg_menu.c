@@ -17,19 +17,35 @@
 
 #include <libpayload.h>
 #include <curses.h>
+#include <string.h>
 #include <flash_access.h>
+#include <sec_store.h>
 #include <sec_reg_menu.h>
 
-#define SERIAL_REG_NO	1
-#define SERIAL_OFFSET	0
-#define MAX_SERIAL_LEN	10
+#define MAC_LEN		6
 
 /* Locking functionality n/a due to not working hardware lock procedure */
 
+static const struct {
+	const char *name;
+	u8 key;
+} sec_keys[] = {
+	{ "serial",	SEC_KEY_SERIAL },
+	{ "asset",	SEC_KEY_ASSET },
+	{ "date",	SEC_KEY_DATE },
+	{ "mac1",	SEC_KEY_MAC1 },
+	{ "mac2",	SEC_KEY_MAC2 },
+	{ "mac3",	SEC_KEY_MAC3 },
+	{ "mac4",	SEC_KEY_MAC4 },
+};
+
 static void print_reg_sec_menu(void) {
 	printf("\n\n--- Security registers menu ---\n\n");
 	printf("  r        - read serial from security register 1\n");
 	printf("  w serial - write serial to security register 1\n");
+	printf("  k        - list the asset data in security register 1\n");
+	printf("  k key=value ... - set asset data, empty value removes\n");
+	printf("             keys: serial asset date mac1-mac4\n");
 	printf("  e        - erase security registers content\n");
 	printf("  s        - get security registers OTP status\n");
 /*      printf("  l reg    - lock security register reg\n"); */
@@ -37,37 +53,48 @@ static void print_reg_sec_menu(void) {
 	printf("\n");
 }
 
+static int is_mac_key(u8 key)
+{
+	return key >= SEC_KEY_MAC1 && key <= SEC_KEY_MAC4;
+}
+
+static int parse_mac(const char *str, u8 *mac)
+{
+	char *end;
+	int i;
+
+	for (i = 0; i < MAC_LEN; i++, str = end + 1) {
+		mac[i] = strtoul(str, &end, 16);
+		if (end != str + 2 || *end != (i < MAC_LEN - 1 ? ':' : '\0'))
+			return -1;
+	}
+
+	return 0;
+}
+
 static void cmd_read_serial(void)
 {
-	u8 reg = SERIAL_REG_NO;
-	u8 offset = SERIAL_OFFSET;
-	u8 buf[MAX_SERIAL_LEN] = { 0 };
-	int ret;
+	char serial[SEC_STORE_SERIAL_LEN] = { 0 };
 
-	ret = read_sec(reg, offset, buf, sizeof(buf));
-	if (ret) {
+	if (sec_store_load()) {
 		printf("can't read register\n");
 		return;
 	}
 
-	if (buf[0] != 0xff) {
-		printf("serial: %s\n", buf);
-	} else {
-		printf("serial: \n");
-	}
+	sec_store_get(SEC_KEY_SERIAL, serial, sizeof(serial) - 1);
+	printf("serial: %s\n", serial);
 }
 
 static void cmd_write_serial(char *cmd)
 {
-	u8 reg = SERIAL_REG_NO;
-	u8 offset = SERIAL_OFFSET;
-	u8 buf[MAX_SERIAL_LEN] = { 0 };
-	int ret;
+	char *serial = cmd + 1;
 
-	strncpy((char *)buf, cmd+2, sizeof(buf)-1);
+	while (*serial == ' ')
+		serial++;
 
-	ret = prog_sec(reg, offset, buf, sizeof(buf));
-	if (ret) {
+	if (sec_store_load() ||
+	    sec_store_set(SEC_KEY_SERIAL, serial, strlen(serial)) ||
+	    sec_store_commit()) {
 		printf("can't write to register\n");
 		return;
 	}
@@ -75,6 +102,95 @@ static void cmd_write_serial(char *cmd)
 	printf("serial written\n");
 }
 
+static void cmd_list_keys(void)
+{
+	u8 value[SEC_STORE_VALUE_MAX + 1];
+	unsigned int i;
+	int len;
+	u8 key;
+
+	for (key = sec_store_next(0); key; key = sec_store_next(key)) {
+		len = sec_store_get(key, value, SEC_STORE_VALUE_MAX);
+		value[len] = '\0';
+
+		for (i = 0; i < ARRAY_SIZE(sec_keys); i++)
+			if (sec_keys[i].key == key)
+				break;
+
+		if (i == ARRAY_SIZE(sec_keys))
+			printf("  0x%02x = %d bytes\n", key, len);
+		else if (is_mac_key(key) && len == MAC_LEN)
+			printf("  %s = %02x:%02x:%02x:%02x:%02x:%02x\n",
+			       sec_keys[i].name, value[0], value[1], value[2],
+			       value[3], value[4], value[5]);
+		else
+			printf("  %s = %s\n", sec_keys[i].name, value);
+	}
+}
+
+/* All assignments go to the register with a single erase, or none */
+static void cmd_keys(char *cmd)
+{
+	u8 mac[MAC_LEN];
+	char *token, *value;
+	unsigned int i;
+	int ret = 0, count = 0;
+
+	if (sec_store_load()) {
+		printf("can't read register\n");
+		return;
+	}
+
+	strtok(cmd, " ");
+	while (!ret && (token = strtok(NULL, " "))) {
+		value = strchr(token, '=');
+		if (!value) {
+			printf("expected key=value: '%s'\n", token);
+			return;
+		}
+		*value++ = '\0';
+
+		for (i = 0; i < ARRAY_SIZE(sec_keys); i++)
+			if (!strcmp(sec_keys[i].name, token))
+				break;
+
+		if (i == ARRAY_SIZE(sec_keys)) {
+			printf("unknown key: '%s'\n", token);
+			return;
+		}
+
+		if (is_mac_key(sec_keys[i].key) && *value) {
+			if (parse_mac(value, mac)) {
+				printf("bad MAC address: '%s'\n", value);
+				return;
+			}
+			ret = sec_store_set(sec_keys[i].key, mac, sizeof(mac));
+		} else {
+			ret = sec_store_set(sec_keys[i].key, value,
+					    strlen(value));
+		}
+
+		if (ret)
+			printf("value of %s too long\n", token);
+		count++;
+	}
+
+	if (ret)
+		return;
+
+	if (!count) {
+		cmd_list_keys();
+		return;
+	}
+
+	if (sec_store_commit()) {
+		printf("can't write to register\n");
+		return;
+	}
+
+	printf("%d key%s written\n", count, count == 1 ? "" : "s");
+}
+
 static void cmd_read_sec_sts(void)
 {
 	int status = read_sec_status();
@@ -88,17 +204,15 @@ static void cmd_read_sec_sts(void)
 
 static void cmd_erase_sec(void)
 {
-	u8 reg = SERIAL_REG_NO;
-	u8 offset = SERIAL_OFFSET;
 	int ret;
 
-	ret = erase_sec(reg, offset, MAX_SERIAL_LEN);
+	ret = erase_sec(SEC_STORE_REG, 0, 1);
 	if (ret) {
 		printf("can't erase security registers\n");
 		return;
 	}
 
-	printf("serial erased\n");
+	printf("security register 1 erased\n");
 }
 
 static void cmd_lock_sec(char *cmd)
@@ -145,6 +259,9 @@ void handle_reg_sec_menu(void) {
 		case 'w':
 			cmd_write_serial(command);
 			break;
+		case 'k':
+			cmd_keys(command);
+			break;
 		case 'e':
 		        cmd_erase_sec();
 			break;
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 PC Engines GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <libpayload.h>
+#include <string.h>
+#include <crc32.h>
+#include <flash_access.h>
+#include <sec_store.h>
+
+#define SEC_STORE_PAGE		256
+#define SEC_STORE_MAGIC		0x564b4253	// "SBKV"
+#define SEC_STORE_LEGACY_LEN	10		// serial of older versions
+
+struct sec_store_header {
+	u32 magic;
+	u16 len;	// bytes of entries following the header
+	u16 reserved;
+	u32 crc;	// of the entries
+} __attribute__((packed));
+
+#define SEC_STORE_DATA	(SEC_STORE_SERIAL_LEN + sizeof(struct sec_store_header))
+#define SEC_STORE_DATA_MAX	(SEC_STORE_PAGE - SEC_STORE_DATA)
+
+static u8 page[SEC_STORE_PAGE];
+static struct sec_store_header *const header =
+	(struct sec_store_header *)(page + SEC_STORE_SERIAL_LEN);
+static u8 *const entries = page + SEC_STORE_DATA;
+
+/*******************************************************************************/
+static u8 *sec_store_find(u8 key)
+{
+	u8 *p;
+
+	for (p = entries; p < entries + header->len; p += 2 + p[1])
+		if (p[0] == key)
+			return p;
+
+	return NULL;
+}
+
+/*******************************************************************************/
+int sec_store_load(void)
+{
+	const u8 *nul;
+	u8 serial[SEC_STORE_LEGACY_LEN];
+	size_t len;
+
+	if (read_sec(SEC_STORE_REG, 0, page, sizeof(page)))
+		return -1;
+
+	if (header->magic == SEC_STORE_MAGIC &&
+	    header->len <= SEC_STORE_DATA_MAX &&
+	    crc32_update(0, entries, header->len) == header->crc)
+		return 0;
+
+	// no store yet, keep a serial written by an older version
+	len = 0;
+	if (page[0] != 0xff) {
+		memcpy(serial, page, sizeof(serial));
+		nul = memchr(serial, 0, sizeof(serial));
+		len = nul ? nul - serial : sizeof(serial);
+	}
+
+	header->len = 0;
+	if (len)
+		sec_store_set(SEC_KEY_SERIAL, serial, len);
+
+	return 0;
+}
+
+/*******************************************************************************/
+int sec_store_get(u8 key, void *buf, size_t len)
+{
+	u8 *p = sec_store_find(key);
+
+	if (!p)
+		return -1;
+
+	len = MIN(len, p[1]);
+	memcpy(buf, p + 2, len);
+
+	return len;
+}
+
+/*******************************************************************************/
+int sec_store_set(u8 key, const void *data, size_t len)
+{
+	u8 *p = sec_store_find(key);
+	size_t room = SEC_STORE_DATA_MAX - header->len;
+	size_t size;
+
+	// the serial is also kept as a string in front of the header
+	if (!key || len > SEC_STORE_VALUE_MAX ||
+	    (key == SEC_KEY_SERIAL && len >= SEC_STORE_SERIAL_LEN))
+		return -1;
+
+	if (p)
+		room += 2 + p[1];
+	if (len && 2 + len > room)
+		return -1;
+
+	if (p) {
+		size = 2 + p[1];
+		memmove(p, p + size, entries + header->len - (p + size));
+		header->len -= size;
+	}
+
+	if (!len)
+		return 0;
+
+	p = entries + header->len;
+	p[0] = key;
+	p[1] = len;
+	memcpy(p + 2, data, len);
+	header->len += 2 + len;
+
+	return 0;
+}
+
+/*******************************************************************************/
+u8 sec_store_next(u8 key)
+{
+	u8 *p = key ? sec_store_find(key) : NULL;
+
+	p = p ? p + 2 + p[1] : entries;
+
+	return p < entries + header->len ? p[0] : 0;
+}
+
+/*******************************************************************************/
+int sec_store_commit(void)
+{
+	u8 check[SEC_STORE_PAGE];
+	int status = read_sec_status();
+	size_t len;
+	int serial;
+
+	if (status < 0 || status & (1 << (SEC_STORE_REG - 1))) {
+		printf("Security register %d is locked\n", SEC_STORE_REG);
+		return -1;
+	}
+
+	// serial string zero padded, as older versions wrote it
+	memset(page, 0, SEC_STORE_SERIAL_LEN);
+	serial = sec_store_get(SEC_KEY_SERIAL, page, SEC_STORE_SERIAL_LEN - 1);
+	if (serial < 0)
+		memset(page, 0xff, SEC_STORE_SERIAL_LEN);
+
+	header->magic = SEC_STORE_MAGIC;
+	header->reserved = 0xffff;
+	header->crc = crc32_update(0, entries, header->len);
+
+	// the rest of the page stays erased
+	len = SEC_STORE_DATA + header->len;
+	memset(page + len, 0xff, sizeof(page) - len);
+
+	if (erase_sec(SEC_STORE_REG, 0, sizeof(page)) ||
+	    prog_sec(SEC_STORE_REG, 0, page, len) ||
+	    read_sec(SEC_STORE_REG, 0, check, sizeof(check)))
+		return -1;
+
+	return memcmp(check, page, sizeof(page)) ? -1 : 0;
+}
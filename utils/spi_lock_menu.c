@@ -19,6 +19,7 @@
 #include <curses.h>
 #include <flash_access.h>
 #include <string.h>
+#include <spi/spi_flash.h>
 #include <spi/winbond_flash.h>
 #include <spi/spi_lock_menu.h>
 
@@ -50,181 +51,67 @@ typedef union {
 	u8 reg_value;
 } winbond_sr2_t;
 
-#define BP_BITS		(sr1.bp0 | (sr1.bp1 << 1) | (sr1.bp2 << 2))
-
-static void print_block_protect_status1(void)
+/* Served from the flash driver cache, refreshed when the menu is entered */
+static int read_sr(winbond_sr1_t *sr1, winbond_sr2_t *sr2)
 {
-	winbond_sr1_t sr1;
-	winbond_sr2_t sr2;
-
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		return;
+	if (read_status_regs(&sr1->reg_value, &sr2->reg_value)) {
+		printf("SPI status register read failed!\n");
+		return -1;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
-		return;
-	}
+	return 0;
+}
 
-	u8 index = 0;
-	printf("%2d) Protected range 000000h – 000000h %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 0)) ? "(currently enabled)" : "");
-	printf("%2d) Protected range 7E0000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 1) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range 7C0000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 2) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range 780000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 3) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range 700000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 4) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range 600000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 5) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range 400000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 6) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 01FFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 1) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 03FFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 2) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 07FFFFh %s\n", ++index,
-	       (!sr2.cmp && sr1.bp2 && !sr1.bp1 && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 0FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 4) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 1FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 5) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 3FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 6) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 7)) ? "(currently enabled)" : "");
-	printf("%2d) Protected range  7FF000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 1) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  7FE000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 2) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  7FC000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 3) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  7F8000h – 7FFFFFh %s\n", ++index,
-	       (!sr2.cmp && sr1.bp2 && !sr1.bp1 && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 000FFFh %s\n", ++index, 
-	       (!sr2.cmp && sr1.sec && sr1.tb && (BP_BITS == 1)) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 001FFFh %s\n", ++index,
-	       (!sr2.cmp && sr1.sec && sr1.tb && (BP_BITS == 2)) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 003FFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 3) && sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 007FFFh %s\n", ++index,
-	       (!sr2.cmp && (BP_BITS == 4) && sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
+/* Block protection settings of the chip, computed once by the probe */
+static int get_bp_table(const struct spi_flash_bp **table, u8 mask[2])
+{
+	int count = flash_bp_table(table, mask);
+
+	if (!count)
+		printf("Block protection layout of this flash is unknown\n");
+
+	return count;
 }
 
-static void print_block_protect_status2(void)
+/* Settings with (cmp = 1) or without the SR2 protection bits, i.e. CMP */
+static void print_block_protect_status(int cmp)
 {
+	const struct spi_flash_bp *table, *bp, *current;
 	winbond_sr1_t sr1;
 	winbond_sr2_t sr2;
+	u8 mask[2];
+	int count, i;
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
+	count = get_bp_table(&table, mask);
+	if (!count || read_sr(&sr1, &sr2))
 		return;
-	}
 
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
-		return;
-	}
+	current = flash_bp_lookup(sr1.reg_value, sr2.reg_value);
 
-	u8 index = 22;
-
-	printf("%2d) Protected range  000000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 0)) ? "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7DFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 1) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7BFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 2) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 3) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 6FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 4) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 5FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 5) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 3FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 6) && !sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  020000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 1) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  040000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 2) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  080000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 3) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  100000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 4) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  200000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 5) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  400000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 6) && !sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 000000h %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 7)) ? "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7FEFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 1) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7FDFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 2) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7FBFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 3) && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  000000h – 7F7FFFh %s\n", ++index,
-	       (sr2.cmp && sr1.bp2 && !sr1.bp1 && sr1.sec && !sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  001000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 1)&& sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  002000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 2) && sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  004000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && (BP_BITS == 3) && sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
-	printf("%2d) Protected range  008000h – 7FFFFFh %s\n", ++index,
-	       (sr2.cmp && sr1.bp2 && !sr1.bp1 && sr1.sec && sr1.tb) ?
-	       "(currently enabled)" : "");
+	for (i = 0; i < count; i++) {
+		bp = &table[i];
+		if (!!(bp->sr2 & mask[1]) != cmp)
+			continue;
+
+		printf("%2d) Protected range %06Xh – %06Xh %s\n", i + 1,
+		       bp->start, bp->len ? bp->start + bp->len - 1 : 0,
+		       bp == current ? "(currently enabled)" : "");
+	}
 }
 
-/* Return WP pin state HIGH = 1 (inactive) or LOW = 0 (active) */
+/*
+ * Return WP pin state HIGH = 1 (inactive) or LOW = 0 (active), -1 if unknown.
+ * With SRP0 set and SRP1 clear the status register only takes writes while
+ * WP is high. The probe goes to the volatile copy of the bits, which is
+ * written at once and never touches the non-volatile ones.
+ */
 static int get_hw_protect_state(void)
 {
 	winbond_sr1_t sr1;
 	winbond_sr2_t sr2;
 
-	send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1);
-	send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1);
+	if (read_sr(&sr1, &sr2))
+		return -1;
 
 	/* SRP0 not set or SRP1 set, WP pin state does not matter */
 	if (!sr1.srp0 || sr2.srp1)
@@ -232,24 +119,21 @@ static int get_hw_protect_state(void)
 
 	/* Try clearing SRP0 bit, if success WP pin is high, else low */
 	sr1.srp0 = 0;
-	u8 status_regs[2] = { sr1.reg_value, sr2.reg_value };
-
-	send_flash_cmd(CMD_W25_WREN, NULL, 0);
-	send_flash_cmd_write(CMD_W25_WRSR, 1, status_regs, 2);
-	send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1);
+	if (write_status_regs_volatile(sr1.reg_value, sr2.reg_value) ||
+	    read_sr(&sr1, &sr2))
+		return -1;
 
 	/* SRP0 did not change, return that WP pin is active */
 	if (sr1.srp0)
 		return 0;
 
-	/* SRP0 cleared, WP pin inactive */
+	/* SRP0 cleared, WP pin inactive, put it back */
 	sr1.srp0 = 1;
-	status_regs[0] = sr1.reg_value;
-	send_flash_cmd(CMD_W25_WREN, NULL, 0);
-	send_flash_cmd_write(CMD_W25_WRSR, 1, status_regs, 2);
-	send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1);
+	if (write_status_regs_volatile(sr1.reg_value, sr2.reg_value) ||
+	    read_sr(&sr1, &sr2))
+		return -1;
 
-	/* Failsafe check, if state restored, return WP active, else error */
+	/* Failsafe check, a power cycle restores SRP0 if this failed */
 	if(sr1.srp0)
 		return 1;
 	else
@@ -261,19 +145,12 @@ static void print_sr_lock_status(void)
 	winbond_sr1_t sr1;
 	winbond_sr2_t sr2;
 
-	u8 wp_pin = get_hw_protect_state();
+	int wp_pin = get_hw_protect_state();
 	if (wp_pin == -1)
 		printf("Error in HW protect state\n");
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	if (read_sr(&sr1, &sr2))
 		return;
-	}
 
 	printf("SRP0=%d , SRP1=%d, WP=%c\n", sr1.srp0, sr2.srp1,
 	       ((wp_pin == -1) || !sr1.srp0) ? '?' : wp_pin + '0');
@@ -292,17 +169,15 @@ static void print_sr_lock_status(void)
 
 static void clear_block_protection(void)
 {
+	const struct spi_flash_bp *table;
 	winbond_sr1_t sr1;
 	winbond_sr2_t sr2;
+	u8 mask[2];
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		printf("Clearing block protection failed!\n");
+	if (!get_bp_table(&table, mask))
 		return;
-	}
 
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	if (read_sr(&sr1, &sr2)) {
 		printf("Clearing block protection failed!\n");
 		return;
 	}
@@ -312,74 +187,34 @@ static void clear_block_protection(void)
 		printf("Disable the protection first!\n");
 	}
 
-	/* 
-	 * Store old register values and mask only the protection bits:
-	 * SRPs, BPs, TB, SEC, LBs , CMP
-	 */
-	u8 status_regs_old[2] = { 
-		(sr1.reg_value & 0xFC) ,
-		(sr2.reg_value & 0x79)
-	};
-
-	sr1.bp0 = 0;
-	sr1.bp1 = 0;
-	sr1.bp2 = 0;
-	sr1.tb  = 0;
-	sr1.sec = 0;
-	sr2.cmp = 0;
+	sr1.reg_value &= ~mask[0];
+	sr2.reg_value &= ~mask[1];
 
-	u8 status_regs[2] = { sr1.reg_value, sr2.reg_value };
-
-	if (send_flash_cmd(CMD_W25_WREN, NULL, 0)) {
-		printf("Sending write enable command failed!\n");
-		printf("Clearing block protection failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd_write(CMD_W25_WRSR, 1, status_regs, 2)) {
+	if (write_status_regs(sr1.reg_value, sr2.reg_value)) {
 		printf("Writing status registers failed!\n");
 		printf("Clearing block protection failed!\n");
 		return;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		printf("Clearing block protection failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	if (read_sr(&sr1, &sr2)) {
 		printf("Clearing block protection failed!\n");
 		return;
 	}
 
-	if(status_regs_old[0] != (sr1.reg_value & 0xFC) &&
-	   status_regs_old[1] != (sr2.reg_value & 0x79)) {
+	if ((sr1.reg_value & mask[0]) || (sr2.reg_value & mask[1])) {
 		printf("Clearing block protection failed!\n");
 	} else {
 		printf("Clearing block protection success!\n");
 	}
 }
 
-static u8 bp_lookup[] = {
-	// CMP = 0
-	0x00, 0x04, 0x08, 0x0C, 0x10, 0x14, 0x18,	// SEC=0, TB=0
-	0x24, 0x28, 0x2C, 0x30, 0x34, 0x38, 0x0E,	// SEC=0, TB=1
-	0x44, 0x48, 0x4C, 0x50,				// SEC=1, TB=0
-	0x64, 0x68, 0x6C, 0x70,				// SEC=1, TB=1
-	// CMP = 1
-	0x00, 0x04, 0x08, 0x0C, 0x10, 0x14, 0x18,	// SEC=0, TB=0
-	0x24, 0x28, 0x2C, 0x30, 0x34, 0x38, 0x0E,	// SEC=0, TB=1
-	0x44, 0x48, 0x4C, 0x50,				// SEC=1, TB=0
-	0x64, 0x68, 0x6C, 0x70,				// SEC=1, TB=1
-};
-
 static void set_block_protection(char* command)
 {
-	int choice;
+	const struct spi_flash_bp *table, *bp;
+	int choice, count;
 	winbond_sr1_t sr1;
 	winbond_sr2_t sr2;
+	u8 mask[2];
 	char delim[] = " ";
 	char *ptr = strtok(command, delim);
 
@@ -397,19 +232,18 @@ static void set_block_protection(char* command)
 		return;
 	}
 
-	if (choice < 1 || choice > 44) {
-		printf("Invalid lock option\n");
+	count = get_bp_table(&table, mask);
+	if (!count)
 		return;
-	}
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		printf("Setting block protection failed!\n");
+	if (choice < 1 || choice > count) {
+		printf("Invalid lock option\n");
 		return;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	bp = &table[choice - 1];
+
+	if (read_sr(&sr1, &sr2)) {
 		printf("Setting block protection failed!\n");
 		return;
 	}
@@ -419,51 +253,21 @@ static void set_block_protection(char* command)
 		printf("Disable the protection first!\n");
 	}
 
-	/* 
-	 * Store old register values and mask only the protection bits:
-	 * SRPs, BPs, TB, SEC, LBs , CMP
-	 */
-	u8 status_regs_old[2] = { 
-		(sr1.reg_value & 0xFC) ,
-		(sr2.reg_value & 0x41)
-	};
-
-	if (choice > 22)
-		sr2.cmp = 1;
-	else
-		sr2.cmp = 0;
-
-	sr1.reg_value &= 0x83; // clear all BPs, SEC and TB
-	sr1.reg_value |= bp_lookup[choice - 1]; // set required bits
-
-	u8 status_regs[2] = { sr1.reg_value, sr2.reg_value };
-
-	if (send_flash_cmd(CMD_W25_WREN, NULL, 0)) {
-		printf("Sending write enable command failed!\n");
-		printf("Setting block protection failed!\n");
-		return;
-	}
+	sr1.reg_value = (sr1.reg_value & ~mask[0]) | bp->sr1;
+	sr2.reg_value = (sr2.reg_value & ~mask[1]) | bp->sr2;
 
-	if (send_flash_cmd_write(CMD_W25_WRSR, 1, status_regs, 2)) {
+	if (write_status_regs(sr1.reg_value, sr2.reg_value)) {
 		printf("Writing status registers failed!\n");
 		printf("Setting block protection failed!\n");
 		return;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		printf("Setting block protection failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	if (read_sr(&sr1, &sr2)) {
 		printf("Setting block protection failed!\n");
 		return;
 	}
 
-	if(status_regs_old[0] == (sr1.reg_value & 0xFC ) &&
-	   status_regs_old[1] == (sr2.reg_value & 0x41)) {
+	if (flash_bp_lookup(sr1.reg_value, sr2.reg_value) != bp) {
 		printf("Setting block protection failed!\n");
 	} else {
 		printf("Setting block protection success!\n");
@@ -498,15 +302,8 @@ static void set_sr_lock(char* command)
 		return;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
+	if (read_sr(&sr1, &sr2))
 		return;
-	}
-
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
-		return;
-	}
 
 	u8 status_regs_old[2] = { 
 		(sr1.reg_value & 0x80) ,
@@ -539,28 +336,13 @@ static void set_sr_lock(char* command)
 		}
 	}
 
-	u8 status_regs[2] = { sr1.reg_value, sr2.reg_value };
-
-	if (send_flash_cmd(CMD_W25_WREN, NULL, 0)) {
-		printf("Sending write enable command failed!\n");
-		printf("Setting status register protection failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd_write(CMD_W25_WRSR, 1, status_regs, 2)) {
+	if (write_status_regs(sr1.reg_value, sr2.reg_value)) {
 		printf("Writing status registers failed!\n");
 		printf("Setting status register protection failed!\n");
 		return;
 	}
 
-	if (send_flash_cmd(CMD_W25_RDSR1, &sr1.reg_value, 1)) {
-		printf("SPI status register 1 read failed!\n");
-		printf("Setting status register protection failed!\n");
-		return;
-	}
-
-	if (send_flash_cmd(CMD_W25_RDSR2, &sr2.reg_value, 1)) {
-		printf("SPI status register 2 read failed!\n");
+	if (read_sr(&sr1, &sr2)) {
 		printf("Setting status register protection failed!\n");
 		return;
 	}
@@ -590,16 +372,19 @@ void handle_spi_lock_menu(void) {
 	bool end = FALSE;
 	char *command;
 
+	/* Pick up changes made to the chip since the last visit */
+	refresh_status_regs();
+
 	while(1) {
 		print_spi_lock_menu();
 		command = readline("> ");
 
 		switch(command[0]) {
 		case 'p':
-			print_block_protect_status1();
+			print_block_protect_status(0);
 			break;
 		case 'r':
-			print_block_protect_status2();
+			print_block_protect_status(1);
 			break;
 		case 'b':
 			set_block_protection(command);